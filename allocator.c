@@ -0,0 +1,179 @@
+// mmap flags beyond C99
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include "allocator.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+#define ONE 1
+
+/**
+ * calloc as an allocator function
+ * @param ctx unused
+ * @param size
+ * @return zeroed memory, NULL upon failure
+ */
+void *default_allocate (void *ctx, size_t size)
+{
+  (void) ctx;
+  return calloc (ONE, size);
+}
+
+/**
+ * free as an allocator function
+ * @param ctx unused
+ * @param memory
+ * @param size unused
+ */
+void default_deallocate (void *ctx, void *memory, size_t size)
+{
+  (void) ctx;
+  (void) size;
+  free (memory);
+}
+
+/**
+ * @return the default allocator, calloc and free.
+ */
+hashmap_allocator allocator_default (void)
+{
+  hashmap_allocator allocator = {default_allocate, default_deallocate, NULL};
+  return allocator;
+}
+
+/**
+ * Allocates size bytes of zeroed memory with an allocator.
+ * @param allocator NULL for the default one.
+ * @param size
+ * @return the memory, NULL upon failure.
+ */
+void *allocator_allocate (const hashmap_allocator *allocator, size_t size)
+{
+  if (allocator == NULL)
+    {
+      return default_allocate (NULL, size);
+    }
+  return allocator->allocate (allocator->ctx, size);
+}
+
+/**
+ * Frees memory allocated with an allocator.
+ * @param allocator NULL for the default one.
+ * @param memory may be NULL.
+ * @param size the size memory was allocated with.
+ */
+void allocator_deallocate (const hashmap_allocator *allocator, void *memory,
+                           size_t size)
+{
+  if (memory == NULL)
+    {
+      return;
+    }
+  if (allocator == NULL)
+    {
+      default_deallocate (NULL, memory, size);
+      return;
+    }
+  allocator->deallocate (allocator->ctx, memory, size);
+}
+
+#ifdef __linux__
+
+/**
+ * @param size
+ * @return size rounded up to whole huge pages
+ */
+size_t huge_page_round (size_t size)
+{
+  return (size + ALLOCATOR_HUGE_PAGE_SIZE - ONE)
+         / ALLOCATOR_HUGE_PAGE_SIZE * ALLOCATOR_HUGE_PAGE_SIZE;
+}
+
+/**
+ * maps large allocations in huge pages (anonymous mappings are zeroed)
+ * @param ctx unused
+ * @param size
+ * @return zeroed memory, NULL upon failure
+ */
+void *huge_page_allocate (void *ctx, size_t size)
+{
+  if (size < ALLOCATOR_HUGE_PAGE_SIZE)
+    {
+      return default_allocate (ctx, size);
+    }
+  // a huge page more than needed, trimmed to a range aligned to a huge page
+  // so the advice covers the whole of it
+  size_t length = huge_page_round (size);
+  void *mapping = mmap (NULL, length + ALLOCATOR_HUGE_PAGE_SIZE,
+                        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -ONE, 0);
+  if (mapping == MAP_FAILED)
+    {
+      return NULL;
+    }
+  uintptr_t start = (uintptr_t) mapping;
+  uintptr_t aligned = (start + ALLOCATOR_HUGE_PAGE_SIZE - ONE)
+                      & ~(ALLOCATOR_HUGE_PAGE_SIZE - ONE);
+  size_t head = aligned - start;
+  if (head > 0)
+    {
+      munmap (mapping, head);
+    }
+  munmap ((void *) (aligned + length), ALLOCATOR_HUGE_PAGE_SIZE - head);
+  void *memory = (void *) aligned;
+#ifdef MADV_HUGEPAGE
+  // only advice, the mapping works with regular pages too
+  madvise (memory, length, MADV_HUGEPAGE);
+#endif
+  return memory;
+}
+
+/**
+ * unmaps allocations mapped by huge_page_allocate
+ * @param ctx unused
+ * @param memory
+ * @param size the size memory was allocated with
+ */
+void huge_page_deallocate (void *ctx, void *memory, size_t size)
+{
+  if (size < ALLOCATOR_HUGE_PAGE_SIZE)
+    {
+      default_deallocate (ctx, memory, size);
+      return;
+    }
+  if (memory != NULL)
+    {
+      munmap (memory, huge_page_round (size));
+    }
+}
+
+/**
+ * @return an allocator which backs allocations of at least
+ * ALLOCATOR_HUGE_PAGE_SIZE bytes with anonymous mappings aligned to and
+ * advised to use huge pages (cutting the TLB misses of large bucket arrays), and gives smaller
+ * ones to calloc. Where mappings are not available it is the default one.
+ */
+hashmap_allocator allocator_huge_pages (void)
+{
+  hashmap_allocator allocator = {huge_page_allocate, huge_page_deallocate,
+                                 NULL};
+  return allocator;
+}
+
+#else
+
+/**
+ * @return an allocator which backs allocations of at least
+ * ALLOCATOR_HUGE_PAGE_SIZE bytes with anonymous mappings aligned to and
+ * advised to use huge pages (cutting the TLB misses of large bucket arrays), and gives smaller
+ * ones to calloc. Where mappings are not available it is the default one.
+ */
+hashmap_allocator allocator_huge_pages (void)
+{
+  return allocator_default ();
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef ALLOCATOR_H_
+#define ALLOCATOR_H_
+
+#include <stdlib.h>
+
+/**
+ * @def ALLOCATOR_HUGE_PAGE_SIZE
+ * The size of a huge page. The huge page allocator maps allocations of at
+ * least this size in whole huge pages, and leaves smaller ones to malloc.
+ */
+#define ALLOCATOR_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+/**
+ * @typedef allocator_allocate_func
+ * Allocates size bytes of zeroed memory, aligned for any type, with the
+ * allocator's context. Returns NULL upon failure.
+ */
+typedef void *(*allocator_allocate_func) (void *, size_t);
+
+/**
+ * @typedef allocator_deallocate_func
+ * Frees memory allocated by the allocator, given with its context and the
+ * size it was allocated with. Ignores NULL.
+ */
+typedef void (*allocator_deallocate_func) (void *, void *, size_t);
+
+/**
+ * @struct hashmap_allocator - an allocator of memory.
+ * @param allocate, deallocate the functions of the allocator.
+ * @param ctx a context pointer passed to them.
+ */
+typedef struct hashmap_allocator {
+    allocator_allocate_func allocate;
+    allocator_deallocate_func deallocate;
+    void *ctx;
+} hashmap_allocator;
+
+/**
+ * @return the default allocator, calloc and free.
+ */
+hashmap_allocator allocator_default (void);
+
+/**
+ * Allocates size bytes of zeroed memory with an allocator.
+ * @param allocator NULL for the default one.
+ * @param size
+ * @return the memory, NULL upon failure.
+ */
+void *allocator_allocate (const hashmap_allocator *allocator, size_t size);
+
+/**
+ * Frees memory allocated with an allocator.
+ * @param allocator NULL for the default one.
+ * @param memory may be NULL.
+ * @param size the size memory was allocated with.
+ */
+void allocator_deallocate (const hashmap_allocator *allocator, void *memory,
+                           size_t size);
+
+/**
+ * @return an allocator which backs allocations of at least
+ * ALLOCATOR_HUGE_PAGE_SIZE bytes with anonymous mappings aligned to and
+ * advised to use huge pages (cutting the TLB misses of large bucket arrays), and gives smaller
+ * ones to calloc. Where mappings are not available it is the default one.
+ */
+hashmap_allocator allocator_huge_pages (void);
+
+#endif //ALLOCATOR_H_
@@ -0,0 +1,531 @@
+/**
+ * Hash map microbenchmarks.
+ * Usage: bench [max_size]
+ * Runs every workload for every key type on sizes 1000, 10000, ... up to
+ * max_size (default 1000000, up to 100000000), each (key type, size) in its
+ * own process so peak RSS is measured per run. Results are printed to stdout
+ * as CSV:
+ * key_type,workload,size,ops,seconds,ops_per_sec,ns_per_op,peak_rss_kb
+ *
+ * The string_additive* and string_siphash* key types compare hash flooding
+ * resistance: *_flood key sets are anagrams of each other, which all collide
+ * under an additive (unkeyed) string hash, but not under keyed SipHash.
+ * string_bloom puts a Bloom filter in front of the buckets, compare its
+ * lookup_miss with the one of string. string_cuckoo stores the pairs in a
+ * cuckoo table instead of in chains, string_compact in an insertion-ordered
+ * compact table. char_inline and int_inline store the keys and their int
+ * values inline, in the pairs (see pair_alloc_inline): compare their
+ * peak_rss_kb with the one of char and int.
+ */
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "hashmap.h"
+#include "test_pairs.h"
+#include "hash_funcs.h"
+
+#define ZERO 0
+#define ONE 1
+#define FAIL 0
+#define SUCCESS 1
+#define MIN_SIZE 1000UL
+#define DEFAULT_MAX_SIZE 1000000UL
+#define MAX_SIZE 100000000UL
+#define SIZE_STEP 10UL
+#define CHAR_KEYS 256UL
+#define STRING_KEY_LEN 24
+#define NANO 1e9
+#define INT_SCRAMBLE 2654435761U
+#define EMPLOYEE_NAME "John Dow"
+#define FLOOD_ALPHABET "abcdefghijkl"
+#define FLOOD_LEN 12
+#define ADDITIVE_MAX_KEYS 10000UL
+
+/**
+ * @struct bench_keys - the keys a single run works on.
+ * @param hit keys inserted to the map.
+ * @param miss keys never inserted to the map.
+ * @param n number of keys in each array.
+ */
+typedef struct bench_keys {
+    const void **hit;
+    const void **miss;
+    void *storage;
+    size_t n;
+} bench_keys;
+
+/**
+ * @typedef bench_keys_init
+ * Creates n hit keys and n miss keys of some type.
+ */
+typedef int (*bench_keys_init) (bench_keys *, size_t);
+
+/**
+ * @struct bench_type - a key type under benchmark.
+ */
+typedef struct bench_type {
+    const char *name;
+    hash_func hash;
+    pair_key_cpy key_cpy;
+    pair_key_cmp key_cmp;
+    pair_key_free key_free;
+    bench_keys_init init;
+    size_t max_keys;
+    keyed_hash_func keyed_hash;
+    int bloom_filter;
+    int cuckoo;
+    int compact;
+    size_t key_size;
+} bench_type;
+
+/**
+ * Copies a NUL terminated string key.
+ */
+void *bench_string_key_cpy (const_keyT key)
+{
+  size_t len = strlen ((const char *) key) + ONE;
+  char *new_string = malloc (len);
+  if (new_string != NULL)
+    {
+      memcpy (new_string, key, len);
+    }
+  return new_string;
+}
+
+/**
+ * Compares two NUL terminated string keys.
+ */
+int bench_string_key_cmp (const_keyT key_1, const_keyT key_2)
+{
+  return strcmp ((const char *) key_1, (const char *) key_2) == ZERO;
+}
+
+/**
+ * The additive string hash the hash maps used to ship with, kept as the
+ * flooding victim.
+ */
+size_t bench_additive_hash (const_keyT key)
+{
+  size_t hash = ZERO;
+  for (const char *c = key; *c != '\0'; c++)
+    {
+      hash += (size_t) *c;
+    }
+  return hash;
+}
+
+/**
+ * Matches every key.
+ */
+int bench_any_key (const_keyT key)
+{
+  (void) key;
+  return ONE;
+}
+
+/**
+ * Increments an int value in place.
+ */
+void bench_increment (valueT value)
+{
+  (*(int *) value)++;
+}
+
+/**
+ * allocates the hit and miss pointer arrays of keys
+ * @return 1 upon success 0 upon failure
+ */
+int alloc_key_arrays (bench_keys *keys, size_t n, size_t elem_size)
+{
+  keys->n = n;
+  keys->hit = malloc (n * sizeof (void *));
+  keys->miss = malloc (n * sizeof (void *));
+  keys->storage = malloc (2 * n * elem_size);
+  return keys->hit != NULL && keys->miss != NULL && keys->storage != NULL;
+}
+
+/**
+ * creates char keys, at most half of the chars are hits
+ */
+int init_char_keys (bench_keys *keys, size_t n)
+{
+  if (!alloc_key_arrays (keys, n, sizeof (char)))
+    {
+      return FAIL;
+    }
+  char *chars = keys->storage;
+  for (size_t i = ZERO; i < 2 * n; i++)
+    {
+      chars[i] = (char) i;
+    }
+  for (size_t i = ZERO; i < n; i++)
+    {
+      keys->hit[i] = &chars[i];
+      keys->miss[i] = &chars[n + i];
+    }
+  return SUCCESS;
+}
+
+/**
+ * creates scrambled distinct int keys
+ */
+int init_int_keys (bench_keys *keys, size_t n)
+{
+  if (!alloc_key_arrays (keys, n, sizeof (int)))
+    {
+      return FAIL;
+    }
+  int *ints = keys->storage;
+  for (size_t i = ZERO; i < 2 * n; i++)
+    {
+      ints[i] = (int) ((unsigned int) i * INT_SCRAMBLE);
+    }
+  for (size_t i = ZERO; i < n; i++)
+    {
+      keys->hit[i] = &ints[i];
+      keys->miss[i] = &ints[n + i];
+    }
+  return SUCCESS;
+}
+
+/**
+ * creates distinct string keys
+ */
+int init_string_keys (bench_keys *keys, size_t n)
+{
+  if (!alloc_key_arrays (keys, n, STRING_KEY_LEN))
+    {
+      return FAIL;
+    }
+  char *strings = keys->storage;
+  for (size_t i = ZERO; i < 2 * n; i++)
+    {
+      snprintf (strings + i * STRING_KEY_LEN, STRING_KEY_LEN, "key%lu",
+                (unsigned long) i);
+    }
+  for (size_t i = ZERO; i < n; i++)
+    {
+      keys->hit[i] = strings + i * STRING_KEY_LEN;
+      keys->miss[i] = strings + (n + i) * STRING_KEY_LEN;
+    }
+  return SUCCESS;
+}
+
+/**
+ * writes the index-th permutation of FLOOD_ALPHABET (factorial number
+ * system) to str
+ */
+void flood_key (size_t index, char *str)
+{
+  char letters[FLOOD_LEN + ONE] = FLOOD_ALPHABET;
+  size_t left = FLOOD_LEN;
+  for (size_t pos = ZERO; pos < FLOOD_LEN; pos++, left--)
+    {
+      size_t pick = index % left;
+      index /= left;
+      str[pos] = letters[pick];
+      memmove (letters + pick, letters + pick + ONE, left - pick);
+    }
+  str[FLOOD_LEN] = '\0';
+}
+
+/**
+ * creates distinct string keys which are all anagrams of each other
+ */
+int init_flood_keys (bench_keys *keys, size_t n)
+{
+  if (!alloc_key_arrays (keys, n, STRING_KEY_LEN))
+    {
+      return FAIL;
+    }
+  char *strings = keys->storage;
+  for (size_t i = ZERO; i < 2 * n; i++)
+    {
+      flood_key (i, strings + i * STRING_KEY_LEN);
+    }
+  for (size_t i = ZERO; i < n; i++)
+    {
+      keys->hit[i] = strings + i * STRING_KEY_LEN;
+      keys->miss[i] = strings + (n + i) * STRING_KEY_LEN;
+    }
+  return SUCCESS;
+}
+
+/**
+ * creates distinct employee keys
+ */
+int init_employee_keys (bench_keys *keys, size_t n)
+{
+  if (!alloc_key_arrays (keys, n, sizeof (Employee)))
+    {
+      return FAIL;
+    }
+  Employee *employees = keys->storage;
+  for (size_t i = ZERO; i < 2 * n; i++)
+    {
+      employees[i].ID = (long) i;
+      employees[i].salary = (long) (i % 1000);
+      employees[i].name = (char **) EMPLOYEE_NAME;
+    }
+  for (size_t i = ZERO; i < n; i++)
+    {
+      keys->hit[i] = &employees[i];
+      keys->miss[i] = &employees[n + i];
+    }
+  return SUCCESS;
+}
+
+/**
+ * frees the keys of a run
+ */
+void free_keys (bench_keys *keys)
+{
+  free (keys->hit);
+  free (keys->miss);
+  free (keys->storage);
+}
+
+/**
+ * @return monotonic time in seconds
+ */
+double now_seconds (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + (double) ts.tv_nsec / NANO;
+}
+
+/**
+ * @return peak resident set size of this process in KB
+ */
+long peak_rss_kb (void)
+{
+  struct rusage usage;
+  if (getrusage (RUSAGE_SELF, &usage) != ZERO)
+    {
+      return -1;
+    }
+  return usage.ru_maxrss;
+}
+
+/**
+ * prints one CSV result line
+ */
+void report (const bench_type *type, const char *workload, size_t size,
+             size_t ops, double seconds)
+{
+  printf ("%s,%s,%lu,%lu,%.6f,%.0f,%.2f,%ld\n", type->name, workload,
+          (unsigned long) size, (unsigned long) ops, seconds,
+          seconds > ZERO ? ops / seconds : ZERO, seconds * NANO / ops,
+          peak_rss_kb ());
+  fflush (stdout);
+}
+
+/**
+ * points the scratch pair at a key, the map copies it on insert
+ */
+void set_key (pair *scratch, const void *key)
+{
+  scratch->key = (keyT) key;
+}
+
+/**
+ * inserts all the hit keys
+ */
+void fill (hashmap *map, pair *scratch, const bench_keys *keys)
+{
+  for (size_t i = ZERO; i < keys->n; i++)
+    {
+      set_key (scratch, keys->hit[i]);
+      hashmap_insert (map, scratch);
+    }
+}
+
+/**
+ * runs all the workloads for one key type and size
+ * @return 1 upon success 0 upon failure
+ */
+int run (const bench_type *type, size_t size)
+{
+  bench_keys keys;
+  if (!type->init (&keys, size))
+    {
+      free_keys (&keys);
+      return FAIL;
+    }
+  hashmap_config config;
+  memset (&config, ZERO, sizeof (hashmap_config));
+  config.keyed_hash = type->keyed_hash;
+  config.bloom_filter = type->bloom_filter;
+  config.cuckoo = type->cuckoo;
+  config.compact = type->compact;
+  hashmap *map = hashmap_alloc_config (type->hash, &config);
+  if (map == NULL)
+    {
+      free_keys (&keys);
+      return FAIL;
+    }
+  int value = ONE;
+  pair_type scratch_type = {type->key_cpy, int_value_cpy, type->key_cmp,
+                            int_value_cmp, type->key_free, int_value_free,
+                            ZERO, ZERO, ZERO, ZERO, NULL};
+  if (type->key_size != ZERO)
+    {
+      pair_type inline_type = {NULL, NULL, type->key_cmp, int_value_cmp, NULL,
+                               NULL, type->key_size, sizeof (int), ZERO,
+                               ZERO, NULL};
+      scratch_type = inline_type;
+    }
+  pair scratch;
+  memset (&scratch, ZERO, sizeof (pair));
+  scratch.value = &value;
+  scratch.type = &scratch_type;
+  volatile size_t found = ZERO;
+
+  double start = now_seconds ();
+  fill (map, &scratch, &keys);
+  report (type, "insert", size, size, now_seconds () - start);
+
+  start = now_seconds ();
+  for (size_t i = ZERO; i < size; i++)
+    {
+      found += hashmap_at (map, keys.hit[i]) != NULL;
+    }
+  report (type, "lookup_hit", size, size, now_seconds () - start);
+
+  start = now_seconds ();
+  for (size_t i = ZERO; i < size; i++)
+    {
+      found += hashmap_at (map, keys.miss[i]) != NULL;
+    }
+  report (type, "lookup_miss", size, size, now_seconds () - start);
+
+  start = now_seconds ();
+  for (size_t i = ZERO; i < size; i++)
+    {
+      found += hashmap_at (map, keys.hit[(i * 7) % size]) != NULL;
+      found += hashmap_at (map, keys.miss[i]) != NULL;
+      hashmap_erase (map, keys.hit[i]);
+      set_key (&scratch, keys.hit[i]);
+      hashmap_insert (map, &scratch);
+    }
+  report (type, "mixed", size, 4 * size, now_seconds () - start);
+
+  start = now_seconds ();
+  hashmap_apply_if (map, bench_any_key, bench_increment);
+  report (type, "apply_if", size, map->size, now_seconds () - start);
+
+  start = now_seconds ();
+  for (size_t i = ZERO; i < size; i++)
+    {
+      hashmap_erase (map, keys.hit[i]);
+    }
+  report (type, "erase", size, size, now_seconds () - start);
+
+  hashmap_free (&map);
+  free_keys (&keys);
+  return SUCCESS;
+}
+
+/**
+ * runs a single (key type, size) benchmark in a child process, so its peak
+ * RSS is not affected by previous runs
+ * @return 1 upon success 0 upon failure
+ */
+int run_isolated (const bench_type *type, size_t size)
+{
+  pid_t pid = fork ();
+  if (pid < ZERO)
+    {
+      return run (type, size);
+    }
+  if (pid == ZERO)
+    {
+      exit (run (type, size) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+  int status;
+  if (waitpid (pid, &status, ZERO) < ZERO)
+    {
+      return FAIL;
+    }
+  return WIFEXITED (status) && WEXITSTATUS (status) == EXIT_SUCCESS;
+}
+
+int main (int argc, char *argv[])
+{
+  size_t max_size = DEFAULT_MAX_SIZE;
+  if (argc > ONE)
+    {
+      max_size = strtoul (argv[ONE], NULL, 10);
+      if (max_size < MIN_SIZE || max_size > MAX_SIZE)
+        {
+          fprintf (stderr, "Usage: %s [max_size in [%lu, %lu]]\n", argv[ZERO],
+                   MIN_SIZE, MAX_SIZE);
+          return EXIT_FAILURE;
+        }
+    }
+  const bench_type types[] = {
+      {"char", hash_char, char_key_cpy, char_key_cmp, char_key_free,
+       init_char_keys, CHAR_KEYS / 2, NULL, ZERO, ZERO, ZERO, ZERO},
+      {"int", hash_int, int_key_cpy, int_key_cmp, int_key_free,
+       init_int_keys, MAX_SIZE, NULL, ZERO, ZERO, ZERO, ZERO},
+      {"char_inline", hash_char, NULL, char_key_cmp, NULL, init_char_keys,
+       CHAR_KEYS / 2, NULL, ZERO, ZERO, ZERO, sizeof (char)},
+      {"int_inline", hash_int, NULL, int_key_cmp, NULL, init_int_keys,
+       MAX_SIZE, NULL, ZERO, ZERO, ZERO, sizeof (int)},
+      {"string", hash_string, bench_string_key_cpy, bench_string_key_cmp,
+       string_key_free, init_string_keys, MAX_SIZE, NULL, ZERO, ZERO, ZERO,
+       ZERO},
+      {"employee", hash_employee, employee_key_cpy, employee_key_cmp,
+       employee_key_free, init_employee_keys, MAX_SIZE, NULL, ZERO, ZERO,
+       ZERO, ZERO},
+      {"string_additive", bench_additive_hash, bench_string_key_cpy,
+       bench_string_key_cmp, string_key_free, init_string_keys,
+       ADDITIVE_MAX_KEYS, NULL, ZERO, ZERO, ZERO, ZERO},
+      {"string_additive_flood", bench_additive_hash, bench_string_key_cpy,
+       bench_string_key_cmp, string_key_free, init_flood_keys,
+       ADDITIVE_MAX_KEYS, NULL, ZERO, ZERO, ZERO, ZERO},
+      {"string_siphash", NULL, bench_string_key_cpy, bench_string_key_cmp,
+       string_key_free, init_string_keys, MAX_SIZE, hash_string_keyed, ZERO,
+       ZERO, ZERO, ZERO},
+      {"string_siphash_flood", NULL, bench_string_key_cpy,
+       bench_string_key_cmp, string_key_free, init_flood_keys, MAX_SIZE,
+       hash_string_keyed, ZERO, ZERO, ZERO, ZERO},
+      {"string_bloom", hash_string, bench_string_key_cpy,
+       bench_string_key_cmp, string_key_free, init_string_keys, MAX_SIZE,
+       NULL, ONE, ZERO, ZERO, ZERO},
+      {"string_cuckoo", hash_string, bench_string_key_cpy,
+       bench_string_key_cmp, string_key_free, init_string_keys, MAX_SIZE,
+       NULL, ZERO, ONE, ZERO, ZERO},
+      {"string_compact", hash_string, bench_string_key_cpy,
+       bench_string_key_cmp, string_key_free, init_string_keys, MAX_SIZE,
+       NULL, ZERO, ZERO, ONE, ZERO},
+  };
+  int status = EXIT_SUCCESS;
+  printf ("key_type,workload,size,ops,seconds,ops_per_sec,ns_per_op,"
+          "peak_rss_kb\n");
+  fflush (stdout);
+  for (size_t size = MIN_SIZE; size <= max_size; size *= SIZE_STEP)
+    {
+      for (size_t t = ZERO; t < sizeof (types) / sizeof (types[ZERO]); t++)
+        {
+          size_t n = size < types[t].max_keys ? size : types[t].max_keys;
+          if (n < size && size > MIN_SIZE)
+            {
+              continue;
+            }
+          if (!run_isolated (&types[t], n))
+            {
+              fprintf (stderr, "bench %s/%lu failed\n", types[t].name,
+                       (unsigned long) n);
+              status = EXIT_FAILURE;
+            }
+        }
+    }
+  return status;
+}
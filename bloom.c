@@ -0,0 +1,154 @@
+#include <string.h>
+#include "bloom.h"
+
+#define ZERO 0
+#define ONE 1
+#define FAIL 0
+#define SUCCESS 1
+#define BLOOM_BLOCK_BYTES (BLOOM_BLOCK_WORDS * sizeof (uint64_t))
+#define BLOOM_MIX 0x9E3779B97F4A7C15ULL
+#define BLOOM_BLOCK_SHIFT 32
+#define BLOOM_BIT_SHIFT 26
+
+/**
+ * odd multipliers deriving the bit of each word of a block from the hash
+ * (the salts of the split block Bloom filter of Apache Parquet)
+ */
+static const uint32_t bloom_salts[BLOOM_BLOCK_WORDS] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+/**
+ * @param filter
+ * @return the size of the allocation holding the blocks of the filter, with
+ * one extra block to align them to a cache line
+ */
+size_t bloom_memory_bytes (const bloom *filter)
+{
+  return (filter->block_count + ONE) * BLOOM_BLOCK_BYTES;
+}
+
+/**
+ * Allocates dynamically an empty filter sized for a hash map.
+ * @param allocator allocates the filter and its blocks, NULL for calloc and
+ * free. It must outlive the filter.
+ * @param capacity the number of buckets of the hash map, a power of 2.
+ * @return pointer to dynamically allocated filter, NULL upon failure.
+ */
+bloom *bloom_alloc (const hashmap_allocator *allocator, size_t capacity)
+{
+  bloom *filter = (bloom *) allocator_allocate (allocator, sizeof (bloom));
+  if (filter == NULL)
+    {
+      return NULL;
+    }
+  filter->allocator = allocator;
+  filter->block_count = capacity / BLOOM_BUCKETS_PER_BLOCK;
+  if (filter->block_count == ZERO)
+    {
+      filter->block_count = ONE;
+    }
+  filter->memory = allocator_allocate (allocator,
+                                       bloom_memory_bytes (filter));
+  if (filter->memory == NULL)
+    {
+      allocator_deallocate (allocator, filter, sizeof (bloom));
+      return NULL;
+    }
+  uintptr_t address = (uintptr_t) filter->memory;
+  address = (address + BLOOM_BLOCK_BYTES - ONE) & ~(BLOOM_BLOCK_BYTES - ONE);
+  filter->blocks = (uint64_t *) address;
+  return filter;
+}
+
+/**
+ * Frees a filter.
+ * @param p_filter pointer to dynamically allocated pointer to filter.
+ */
+void bloom_free (bloom **p_filter)
+{
+  if (p_filter == NULL || *p_filter == NULL)
+    {
+      return;
+    }
+  const hashmap_allocator *allocator = (*p_filter)->allocator;
+  allocator_deallocate (allocator, (*p_filter)->memory,
+                        bloom_memory_bytes (*p_filter));
+  allocator_deallocate (allocator, *p_filter, sizeof (bloom));
+  *p_filter = NULL;
+}
+
+/**
+ * finds the block of a hash and the bits it sets in each word of the block
+ * @param filter
+ * @param hash
+ * @param masks set to one bit per word
+ * @return the first word of the block
+ */
+uint64_t *bloom_block (const bloom *filter, size_t hash,
+                       uint64_t masks[BLOOM_BLOCK_WORDS])
+{
+  // remix, so identity hashes do not pick neighbouring blocks and bits
+  uint64_t mixed = (uint64_t) hash * BLOOM_MIX;
+  size_t block = (size_t) (mixed >> BLOOM_BLOCK_SHIFT)
+                 & (filter->block_count - ONE);
+  uint32_t low = (uint32_t) mixed;
+  for (size_t i = ZERO; i < BLOOM_BLOCK_WORDS; i++)
+    {
+      masks[i] = (uint64_t) ONE << ((uint32_t) (low * bloom_salts[i])
+                                    >> BLOOM_BIT_SHIFT);
+    }
+  return filter->blocks + block * BLOOM_BLOCK_WORDS;
+}
+
+/**
+ * Adds a hash to the filter.
+ * @param filter
+ * @param hash full hash of a key.
+ */
+void bloom_add (bloom *filter, size_t hash)
+{
+  uint64_t masks[BLOOM_BLOCK_WORDS];
+  uint64_t *block = bloom_block (filter, hash, masks);
+  for (size_t i = ZERO; i < BLOOM_BLOCK_WORDS; i++)
+    {
+      block[i] |= masks[i];
+    }
+}
+
+/**
+ * Checks a hash against the filter, reading a single cache line.
+ * @param filter
+ * @param hash full hash of a key.
+ * @return 0 if the hash was surely never added, 1 if it may have been.
+ */
+int bloom_may_contain (const bloom *filter, size_t hash)
+{
+  uint64_t masks[BLOOM_BLOCK_WORDS];
+  const uint64_t *block = bloom_block (filter, hash, masks);
+  uint64_t missing = ZERO;
+  for (size_t i = ZERO; i < BLOOM_BLOCK_WORDS; i++)
+    {
+      missing |= masks[i] & ~block[i];
+    }
+  return missing == ZERO ? SUCCESS : FAIL;
+}
+
+/**
+ * Removes all the hashes from the filter.
+ * @param filter
+ */
+void bloom_clear (bloom *filter)
+{
+  memset (filter->blocks, ZERO, filter->block_count * BLOOM_BLOCK_BYTES);
+}
+
+/**
+ * @param filter
+ * @return the number of bytes allocated by the filter.
+ */
+size_t bloom_bytes (const bloom *filter)
+{
+  return sizeof (bloom) + (filter->block_count + ONE) * BLOOM_BLOCK_BYTES;
+}
@@ -0,0 +1,81 @@
+#ifndef BLOOM_H_
+#define BLOOM_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "allocator.h"
+
+/**
+ * @def BLOOM_BLOCK_WORDS
+ * The number of 64-bit words in a block of the filter. A block fills one
+ * cache line (64 bytes), and a key sets (and checks) one bit in each word of
+ * a single block.
+ */
+#define BLOOM_BLOCK_WORDS 8UL
+
+/**
+ * @def BLOOM_BUCKETS_PER_BLOCK
+ * The filter gets one block for every BLOOM_BUCKETS_PER_BLOCK buckets of the
+ * hash map, about 21 bits per key at the maximal load factor of the map.
+ */
+#define BLOOM_BUCKETS_PER_BLOCK 32UL
+
+/**
+ * @struct bloom - a blocked Bloom filter over full hashes.
+ * @param allocator allocates the filter and its blocks, NULL for calloc and
+ * free.
+ * @param memory the allocation holding the blocks.
+ * @param blocks block_count blocks of BLOOM_BLOCK_WORDS words, aligned to a
+ * cache line.
+ * @param block_count the number of blocks, always a power of 2.
+ */
+typedef struct bloom {
+    const hashmap_allocator *allocator;
+    void *memory;
+    uint64_t *blocks;
+    size_t block_count;
+} bloom;
+
+/**
+ * Allocates dynamically an empty filter sized for a hash map.
+ * @param allocator allocates the filter and its blocks, NULL for calloc and
+ * free. It must outlive the filter.
+ * @param capacity the number of buckets of the hash map, a power of 2.
+ * @return pointer to dynamically allocated filter, NULL upon failure.
+ */
+bloom *bloom_alloc (const hashmap_allocator *allocator, size_t capacity);
+
+/**
+ * Frees a filter.
+ * @param p_filter pointer to dynamically allocated pointer to filter.
+ */
+void bloom_free (bloom **p_filter);
+
+/**
+ * Adds a hash to the filter.
+ * @param filter
+ * @param hash full hash of a key.
+ */
+void bloom_add (bloom *filter, size_t hash);
+
+/**
+ * Checks a hash against the filter, reading a single cache line.
+ * @param filter
+ * @param hash full hash of a key.
+ * @return 0 if the hash was surely never added, 1 if it may have been.
+ */
+int bloom_may_contain (const bloom *filter, size_t hash);
+
+/**
+ * Removes all the hashes from the filter.
+ * @param filter
+ */
+void bloom_clear (bloom *filter);
+
+/**
+ * @param filter
+ * @return the number of bytes allocated by the filter.
+ */
+size_t bloom_bytes (const bloom *filter);
+
+#endif //BLOOM_H_
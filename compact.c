@@ -0,0 +1,244 @@
+#include <string.h>
+#include "compact.h"
+
+#define ZERO 0
+#define ONE 1
+#define FAIL 0
+#define SUCCESS 1
+
+/**
+ * allocates an index of empty slots
+ * @param allocator
+ * @param index_size
+ * @return the index, NULL upon failure
+ */
+int32_t *compact_alloc_index (const hashmap_allocator *allocator,
+                              size_t index_size)
+{
+  int32_t *index = (int32_t *) allocator_allocate
+      (allocator, index_size * sizeof (int32_t));
+  if (index != NULL)
+    {
+      // every byte of COMPACT_EMPTY is 0xff
+      memset (index, 0xff, index_size * sizeof (int32_t));
+    }
+  return index;
+}
+
+/**
+ * frees the arrays of a compact table
+ * @param allocator
+ * @param index
+ * @param index_size
+ * @param entries
+ * @param entry_cap
+ */
+void compact_free_arrays (const hashmap_allocator *allocator, int32_t *index,
+                          size_t index_size, compact_entry *entries,
+                          size_t entry_cap)
+{
+  allocator_deallocate (allocator, index, index_size * sizeof (int32_t));
+  allocator_deallocate (allocator, entries,
+                        entry_cap * sizeof (compact_entry));
+}
+
+/**
+ * Allocates dynamically an empty compact table.
+ * @param allocator allocates the table and its arrays, NULL for calloc and
+ * free. It must outlive the table.
+ * @param index_size the number of index slots, a power of 2.
+ * @param entry_cap the number of entries it holds, less than index_size.
+ * @return pointer to dynamically allocated table, NULL upon failure.
+ */
+compact_table *compact_alloc (const hashmap_allocator *allocator,
+                              size_t index_size, size_t entry_cap)
+{
+  compact_table *table = (compact_table *) allocator_allocate
+      (allocator, sizeof (compact_table));
+  if (table == NULL)
+    {
+      return NULL;
+    }
+  table->allocator = allocator;
+  table->index = compact_alloc_index (allocator, index_size);
+  table->entries = (compact_entry *) allocator_allocate
+      (allocator, entry_cap * sizeof (compact_entry));
+  if (table->index == NULL || table->entries == NULL)
+    {
+      compact_free_arrays (allocator, table->index, index_size,
+                           table->entries, entry_cap);
+      allocator_deallocate (allocator, table, sizeof (compact_table));
+      return NULL;
+    }
+  table->index_size = index_size;
+  table->entry_cap = entry_cap;
+  table->used = ZERO;
+  table->size = ZERO;
+  return table;
+}
+
+/**
+ * Frees all the pairs of a compact table, keeping its arrays.
+ * @param table
+ */
+void compact_clear (compact_table *table)
+{
+  for (size_t i = ZERO; i < table->used; i++)
+    {
+      pair_free ((void **) &table->entries[i].pair);
+    }
+  memset (table->index, 0xff, table->index_size * sizeof (int32_t));
+  table->used = ZERO;
+  table->size = ZERO;
+}
+
+/**
+ * Frees a compact table and the pairs it holds.
+ * @param p_table pointer to dynamically allocated pointer to table.
+ */
+void compact_free (compact_table **p_table)
+{
+  if (p_table == NULL || *p_table == NULL)
+    {
+      return;
+    }
+  compact_clear (*p_table);
+  compact_table *table = *p_table;
+  compact_free_arrays (table->allocator, table->index, table->index_size,
+                       table->entries, table->entry_cap);
+  allocator_deallocate (table->allocator, table, sizeof (compact_table));
+  *p_table = NULL;
+}
+
+/**
+ * Finds key in the table.
+ * @param table
+ * @param key
+ * @param hash full hash of key.
+ * @param key_cmp_calls incremented for every key_cmp call, may be NULL.
+ * @param p_slot if not NULL, set to the index slot of the pair (for
+ * compact_erase) when it is found.
+ * @return the pair holding key, NULL if not found.
+ */
+pair *compact_find (const compact_table *table, const_keyT key, size_t hash,
+                    size_t *key_cmp_calls, size_t *p_slot)
+{
+  size_t mask = table->index_size - ONE;
+  for (size_t slot = hash & mask; table->index[slot] != COMPACT_EMPTY;
+       slot = (slot + ONE) & mask)
+    {
+      if (table->index[slot] == COMPACT_DUMMY)
+        {
+          continue;
+        }
+      const compact_entry *entry = &table->entries[table->index[slot]];
+      if (entry->hash != hash)
+        {
+          continue;
+        }
+      if (key_cmp_calls != NULL)
+        {
+          (*key_cmp_calls)++;
+        }
+      if (entry->pair->type->key_cmp (entry->pair->key, key) == ONE)
+        {
+          if (p_slot != NULL)
+            {
+              *p_slot = slot;
+            }
+          return entry->pair;
+        }
+    }
+  return NULL;
+}
+
+/**
+ * puts the offset of an entry in the first free slot of its probe sequence
+ */
+void compact_index_entry (int32_t *index, size_t index_size, size_t hash,
+                          size_t offset)
+{
+  size_t mask = index_size - ONE;
+  size_t slot = hash & mask;
+  while (index[slot] >= ZERO)
+    {
+      slot = (slot + ONE) & mask;
+    }
+  index[slot] = (int32_t) offset;
+}
+
+/**
+ * Appends a pair (whose hash is cached) to the table.
+ * @param table
+ * @param new_pair dynamically allocated pair, the table takes ownership of
+ * it upon success.
+ * @return 1 upon success, 0 if the entries are full (the table should be
+ * rehashed).
+ */
+int compact_insert (compact_table *table, pair *new_pair)
+{
+  if (table->used == table->entry_cap)
+    {
+      return FAIL;
+    }
+  table->entries[table->used].hash = new_pair->hash;
+  table->entries[table->used].pair = new_pair;
+  compact_index_entry (table->index, table->index_size, new_pair->hash,
+                       table->used);
+  table->used++;
+  table->size++;
+  return SUCCESS;
+}
+
+/**
+ * Erases (and frees) the pair at the given index slot.
+ * @param table
+ * @param slot slot set by compact_find.
+ */
+void compact_erase (compact_table *table, size_t slot)
+{
+  pair_free ((void **) &table->entries[table->index[slot]].pair);
+  table->index[slot] = COMPACT_DUMMY;
+  table->size--;
+}
+
+/**
+ * Rebuilds the index with a new number of slots, and packs the entries
+ * (dropping the erased ones, keeping the order of the others).
+ * @param table
+ * @param index_size the new number of index slots, a power of 2.
+ * @param entry_cap the new number of entries, at least size and less than
+ * index_size.
+ * @return 1 upon success 0 upon failure (the table is left untouched).
+ */
+int compact_rehash (compact_table *table, size_t index_size,
+                    size_t entry_cap)
+{
+  int32_t *index = compact_alloc_index (table->allocator, index_size);
+  compact_entry *entries = (compact_entry *) allocator_allocate
+      (table->allocator, entry_cap * sizeof (compact_entry));
+  if (index == NULL || entries == NULL)
+    {
+      compact_free_arrays (table->allocator, index, index_size, entries,
+                           entry_cap);
+      return FAIL;
+    }
+  size_t used = ZERO;
+  for (size_t i = ZERO; i < table->used; i++)
+    {
+      if (table->entries[i].pair != NULL)
+        {
+          entries[used] = table->entries[i];
+          compact_index_entry (index, index_size, entries[used].hash, used);
+          used++;
+        }
+    }
+  compact_free_arrays (table->allocator, table->index, table->index_size,
+                       table->entries, table->entry_cap);
+  table->index = index;
+  table->index_size = index_size;
+  table->entries = entries;
+  table->entry_cap = entry_cap;
+  table->used = used;
+  return SUCCESS;
+}
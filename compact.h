@@ -0,0 +1,123 @@
+#ifndef COMPACT_H_
+#define COMPACT_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "pair.h"
+#include "allocator.h"
+
+/**
+ * @def COMPACT_EMPTY, COMPACT_DUMMY
+ * Values of index slots which hold no entry: never used, and used by an
+ * erased entry (probing goes on past it).
+ */
+#define COMPACT_EMPTY (-1)
+#define COMPACT_DUMMY (-2)
+
+/**
+ * @def COMPACT_MIN_INDEX
+ * The minimal number of index slots, so the index always keeps an empty slot
+ * which ends the probing.
+ */
+#define COMPACT_MIN_INDEX 2UL
+
+/**
+ * @struct compact_entry - an entry of the dense array.
+ * @param hash the full hash of the pair's key.
+ * @param pair the pair, NULL for an erased entry.
+ */
+typedef struct compact_entry {
+    size_t hash;
+    pair *pair;
+} compact_entry;
+
+/**
+ * @struct compact_table - insertion-ordered compact table: the entries are
+ * appended to a dense array, and a sparse index of int32 offsets into it is
+ * probed linearly by hash.
+ * @param allocator allocates the table and its arrays, NULL for calloc and
+ * free.
+ * @param index index_size offsets into entries, or COMPACT_EMPTY /
+ * COMPACT_DUMMY.
+ * @param index_size the number of index slots, always a power of 2.
+ * @param entries the entries, in insertion order.
+ * @param used the number of entries appended (including erased ones).
+ * @param entry_cap the number of entries the array holds.
+ * @param size the number of pairs in the table.
+ */
+typedef struct compact_table {
+    const hashmap_allocator *allocator;
+    int32_t *index;
+    size_t index_size;
+    compact_entry *entries;
+    size_t used;
+    size_t entry_cap;
+    size_t size;
+} compact_table;
+
+/**
+ * Allocates dynamically an empty compact table.
+ * @param allocator allocates the table and its arrays, NULL for calloc and
+ * free. It must outlive the table.
+ * @param index_size the number of index slots, a power of 2.
+ * @param entry_cap the number of entries it holds, less than index_size.
+ * @return pointer to dynamically allocated table, NULL upon failure.
+ */
+compact_table *compact_alloc (const hashmap_allocator *allocator,
+                              size_t index_size, size_t entry_cap);
+
+/**
+ * Frees a compact table and the pairs it holds.
+ * @param p_table pointer to dynamically allocated pointer to table.
+ */
+void compact_free (compact_table **p_table);
+
+/**
+ * Frees all the pairs of a compact table, keeping its arrays.
+ * @param table
+ */
+void compact_clear (compact_table *table);
+
+/**
+ * Finds key in the table.
+ * @param table
+ * @param key
+ * @param hash full hash of key.
+ * @param key_cmp_calls incremented for every key_cmp call, may be NULL.
+ * @param p_slot if not NULL, set to the index slot of the pair (for
+ * compact_erase) when it is found.
+ * @return the pair holding key, NULL if not found.
+ */
+pair *compact_find (const compact_table *table, const_keyT key, size_t hash,
+                    size_t *key_cmp_calls, size_t *p_slot);
+
+/**
+ * Appends a pair (whose hash is cached) to the table.
+ * @param table
+ * @param new_pair dynamically allocated pair, the table takes ownership of
+ * it upon success.
+ * @return 1 upon success, 0 if the entries are full (the table should be
+ * rehashed).
+ */
+int compact_insert (compact_table *table, pair *new_pair);
+
+/**
+ * Erases (and frees) the pair at the given index slot.
+ * @param table
+ * @param slot slot set by compact_find.
+ */
+void compact_erase (compact_table *table, size_t slot);
+
+/**
+ * Rebuilds the index with a new number of slots, and packs the entries
+ * (dropping the erased ones, keeping the order of the others).
+ * @param table
+ * @param index_size the new number of index slots, a power of 2.
+ * @param entry_cap the new number of entries, at least size and less than
+ * index_size.
+ * @return 1 upon success 0 upon failure (the table is left untouched).
+ */
+int compact_rehash (compact_table *table, size_t index_size,
+                    size_t entry_cap);
+
+#endif //COMPACT_H_
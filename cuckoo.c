@@ -0,0 +1,310 @@
+#include <stdint.h>
+#include "cuckoo.h"
+
+#define ZERO 0
+#define ONE 1
+#define FAIL 0
+#define SUCCESS 1
+#define CUCKOO_CACHE_LINE 64UL
+#define CUCKOO_MIX 0x9E3779B97F4A7C15ULL
+#define CUCKOO_TAG_SHIFT 32
+
+/**
+ * @param bucket_count
+ * @return the size of the allocation holding bucket_count buckets, with
+ * extra room to align them to a cache line
+ */
+size_t cuckoo_memory_bytes (size_t bucket_count)
+{
+  return bucket_count * sizeof (cuckoo_bucket) + CUCKOO_CACHE_LINE;
+}
+
+/**
+ * Allocates dynamically an empty cuckoo table.
+ * @param allocator allocates the table and its buckets, NULL for calloc and
+ * free. It must outlive the table.
+ * @param bucket_count the number of buckets, a power of 2.
+ * @return pointer to dynamically allocated table, NULL upon failure.
+ */
+cuckoo_table *cuckoo_alloc (const hashmap_allocator *allocator,
+                            size_t bucket_count)
+{
+  cuckoo_table *table = (cuckoo_table *) allocator_allocate
+      (allocator, sizeof (cuckoo_table));
+  if (table == NULL)
+    {
+      return NULL;
+    }
+  table->allocator = allocator;
+  table->memory = allocator_allocate (allocator,
+                                      cuckoo_memory_bytes (bucket_count));
+  if (table->memory == NULL)
+    {
+      allocator_deallocate (allocator, table, sizeof (cuckoo_table));
+      return NULL;
+    }
+  uintptr_t address = (uintptr_t) table->memory;
+  address = (address + CUCKOO_CACHE_LINE - ONE) & ~(CUCKOO_CACHE_LINE - ONE);
+  table->buckets = (cuckoo_bucket *) address;
+  table->bucket_count = bucket_count;
+  table->size = ZERO;
+  return table;
+}
+
+/**
+ * Frees all the pairs of a cuckoo table, keeping its buckets.
+ * @param table
+ */
+void cuckoo_clear (cuckoo_table *table)
+{
+  for (size_t i = ZERO; i < table->bucket_count && table->size > ZERO; i++)
+    {
+      for (size_t j = ZERO; j < CUCKOO_BUCKET_SLOTS; j++)
+        {
+          if (table->buckets[i].pairs[j] != NULL)
+            {
+              pair_free ((void **) &table->buckets[i].pairs[j]);
+              table->size--;
+            }
+        }
+    }
+  table->size = ZERO;
+}
+
+/**
+ * Frees a cuckoo table and the pairs it holds.
+ * @param p_table pointer to dynamically allocated pointer to table.
+ */
+void cuckoo_free (cuckoo_table **p_table)
+{
+  if (p_table == NULL || *p_table == NULL)
+    {
+      return;
+    }
+  cuckoo_clear (*p_table);
+  const hashmap_allocator *allocator = (*p_table)->allocator;
+  allocator_deallocate (allocator, (*p_table)->memory,
+                        cuckoo_memory_bytes ((*p_table)->bucket_count));
+  allocator_deallocate (allocator, *p_table, sizeof (cuckoo_table));
+  *p_table = NULL;
+}
+
+/**
+ * @return the first bucket of a hash
+ */
+size_t cuckoo_index (const cuckoo_table *table, size_t hash)
+{
+  return hash & (table->bucket_count - ONE);
+}
+
+/**
+ * calculates the other bucket of a hash from one of its buckets. The
+ * offset depends on the hash only, so applying it twice gives back the
+ * first bucket, and it is odd, so the two buckets differ.
+ * @return the alternative bucket of hash to index
+ */
+size_t cuckoo_alt_index (const cuckoo_table *table, size_t index,
+                         size_t hash)
+{
+  size_t offset = (size_t) (((uint64_t) hash * CUCKOO_MIX)
+                            >> CUCKOO_TAG_SHIFT) | ONE;
+  return (index ^ offset) & (table->bucket_count - ONE);
+}
+
+/**
+ * @param current a bucket
+ * @return the number of pairs in the bucket
+ */
+size_t cuckoo_bucket_size (const cuckoo_bucket *current)
+{
+  size_t size = ZERO;
+  for (size_t j = ZERO; j < CUCKOO_BUCKET_SLOTS; j++)
+    {
+      size += current->pairs[j] != NULL;
+    }
+  return size;
+}
+
+/**
+ * looks for key in a single bucket
+ * @return the slot of key, CUCKOO_BUCKET_SLOTS if not found
+ */
+size_t cuckoo_find_in_bucket (const cuckoo_bucket *current, const_keyT key,
+                              size_t hash, size_t *key_cmp_calls)
+{
+  for (size_t j = ZERO; j < CUCKOO_BUCKET_SLOTS; j++)
+    {
+      if (current->pairs[j] != NULL && current->hashes[j] == hash)
+        {
+          if (key_cmp_calls != NULL)
+            {
+              (*key_cmp_calls)++;
+            }
+          const pair *candidate = current->pairs[j];
+          if (candidate->type->key_cmp (candidate->key, key) == ONE)
+            {
+              return j;
+            }
+        }
+    }
+  return CUCKOO_BUCKET_SLOTS;
+}
+
+/**
+ * Finds key in the table.
+ * @param table
+ * @param key
+ * @param hash full hash of key.
+ * @param key_cmp_calls incremented for every key_cmp call, may be NULL.
+ * @param p_position if not NULL, set to the position of the pair (for
+ * cuckoo_erase) when it is found.
+ * @return the pair holding key, NULL if not found.
+ */
+pair *cuckoo_find (const cuckoo_table *table, const_keyT key, size_t hash,
+                   size_t *key_cmp_calls, size_t *p_position)
+{
+  size_t index = cuckoo_index (table, hash);
+  for (int choice = ZERO; choice < 2; choice++)
+    {
+      const cuckoo_bucket *current = &table->buckets[index];
+      size_t slot = cuckoo_find_in_bucket (current, key, hash,
+                                           key_cmp_calls);
+      if (slot < CUCKOO_BUCKET_SLOTS)
+        {
+          if (p_position != NULL)
+            {
+              *p_position = index * CUCKOO_BUCKET_SLOTS + slot;
+            }
+          return current->pairs[slot];
+        }
+      index = cuckoo_alt_index (table, index, hash);
+    }
+  return NULL;
+}
+
+/**
+ * puts a pair in an empty slot of a bucket
+ * @return 1 upon success, 0 if the bucket is full
+ */
+int cuckoo_place (cuckoo_bucket *current, pair *new_pair)
+{
+  for (size_t j = ZERO; j < CUCKOO_BUCKET_SLOTS; j++)
+    {
+      if (current->pairs[j] == NULL)
+        {
+          current->pairs[j] = new_pair;
+          current->hashes[j] = new_pair->hash;
+          return SUCCESS;
+        }
+    }
+  return FAIL;
+}
+
+/**
+ * swaps a pair with the pair in a slot of a bucket
+ * @return the pair which was in the slot
+ */
+pair *cuckoo_swap (cuckoo_bucket *current, size_t slot, pair *in_pair)
+{
+  pair *out_pair = current->pairs[slot];
+  current->pairs[slot] = in_pair;
+  current->hashes[slot] = in_pair->hash;
+  return out_pair;
+}
+
+/**
+ * Inserts a pair (whose hash is cached) to the table, displacing other pairs
+ * to their alternative buckets if both of its buckets are full.
+ * @param table
+ * @param new_pair dynamically allocated pair, the table takes ownership of
+ * it upon success.
+ * @return 1 upon success, 0 if no room was found within CUCKOO_MAX_KICKS
+ * displacements (the table is left untouched and should grow).
+ */
+int cuckoo_insert (cuckoo_table *table, pair *new_pair)
+{
+  size_t index = cuckoo_index (table, new_pair->hash);
+  size_t alt_index = cuckoo_alt_index (table, index, new_pair->hash);
+  if (cuckoo_place (&table->buckets[index], new_pair)
+      || cuckoo_place (&table->buckets[alt_index], new_pair))
+    {
+      table->size++;
+      return SUCCESS;
+    }
+  // random walk, remembering the displacements to undo them upon failure
+  size_t path[CUCKOO_MAX_KICKS];
+  pair *homeless = new_pair;
+  size_t random = new_pair->hash;
+  for (size_t kick = ZERO; kick < CUCKOO_MAX_KICKS; kick++)
+    {
+      random = random * CUCKOO_MIX + ONE;
+      size_t slot = (size_t) (random >> CUCKOO_TAG_SHIFT)
+                    % CUCKOO_BUCKET_SLOTS;
+      path[kick] = index * CUCKOO_BUCKET_SLOTS + slot;
+      homeless = cuckoo_swap (&table->buckets[index], slot, homeless);
+      index = cuckoo_alt_index (table, index, homeless->hash);
+      if (cuckoo_place (&table->buckets[index], homeless))
+        {
+          table->size++;
+          return SUCCESS;
+        }
+    }
+  for (size_t kick = CUCKOO_MAX_KICKS; kick > ZERO; kick--)
+    {
+      size_t position = path[kick - ONE];
+      homeless = cuckoo_swap (&table->buckets[position
+                                              / CUCKOO_BUCKET_SLOTS],
+                              position % CUCKOO_BUCKET_SLOTS, homeless);
+    }
+  return FAIL;
+}
+
+/**
+ * Erases (and frees) the pair at the given position.
+ * @param table
+ * @param position position set by cuckoo_find.
+ */
+void cuckoo_erase (cuckoo_table *table, size_t position)
+{
+  cuckoo_bucket *current = &table->buckets[position / CUCKOO_BUCKET_SLOTS];
+  pair_free ((void **) &current->pairs[position % CUCKOO_BUCKET_SLOTS]);
+  table->size--;
+}
+
+/**
+ * Moves all the pairs to a new number of buckets.
+ * @param table
+ * @param bucket_count the new number of buckets, a power of 2.
+ * @return 1 upon success 0 upon failure (the table is left untouched).
+ */
+int cuckoo_rehash (cuckoo_table *table, size_t bucket_count)
+{
+  cuckoo_table *new_table = cuckoo_alloc (table->allocator, bucket_count);
+  if (new_table == NULL)
+    {
+      return FAIL;
+    }
+  for (size_t i = ZERO; i < table->bucket_count; i++)
+    {
+      for (size_t j = ZERO; j < CUCKOO_BUCKET_SLOTS; j++)
+        {
+          pair *current = table->buckets[i].pairs[j];
+          if (current != NULL && cuckoo_insert (new_table, current) == FAIL)
+            {
+              // the pairs are still owned by table
+              allocator_deallocate (table->allocator, new_table->memory,
+                                    cuckoo_memory_bytes (bucket_count));
+              allocator_deallocate (table->allocator, new_table,
+                                    sizeof (cuckoo_table));
+              return FAIL;
+            }
+        }
+    }
+  allocator_deallocate (table->allocator, table->memory,
+                        cuckoo_memory_bytes (table->bucket_count));
+  table->memory = new_table->memory;
+  table->buckets = new_table->buckets;
+  table->bucket_count = bucket_count;
+  allocator_deallocate (table->allocator, new_table, sizeof (cuckoo_table));
+  return SUCCESS;
+}
@@ -0,0 +1,118 @@
+#ifndef CUCKOO_H_
+#define CUCKOO_H_
+
+#include <stdlib.h>
+#include "pair.h"
+#include "allocator.h"
+
+/**
+ * @def CUCKOO_BUCKET_SLOTS
+ * The number of pairs a bucket of the cuckoo table holds. A bucket (the
+ * cached hashes and the pairs' pointers) fills one 64-byte cache line.
+ */
+#define CUCKOO_BUCKET_SLOTS 4UL
+
+/**
+ * @def CUCKOO_MAX_KICKS
+ * The maximal number of pairs an insertion may displace before the table is
+ * considered full and has to grow.
+ */
+#define CUCKOO_MAX_KICKS 128UL
+
+/**
+ * @struct cuckoo_bucket - CUCKOO_BUCKET_SLOTS slots of a cuckoo table.
+ * @param hashes the full hashes of the pairs, compared before any key_cmp.
+ * @param pairs the pairs, NULL for an empty slot.
+ */
+typedef struct cuckoo_bucket {
+    size_t hashes[CUCKOO_BUCKET_SLOTS];
+    pair *pairs[CUCKOO_BUCKET_SLOTS];
+} cuckoo_bucket;
+
+/**
+ * @struct cuckoo_table - bucketized cuckoo hash table. Every pair lives in
+ * one of two buckets, both derived from its full hash, so a lookup reads at
+ * most two buckets whatever the collisions are.
+ * @param allocator allocates the table and its buckets, NULL for calloc and
+ * free.
+ * @param memory the allocation holding the buckets.
+ * @param buckets bucket_count buckets, aligned to a cache line.
+ * @param bucket_count the number of buckets, always a power of 2.
+ * @param size the number of pairs in the table.
+ */
+typedef struct cuckoo_table {
+    const hashmap_allocator *allocator;
+    void *memory;
+    cuckoo_bucket *buckets;
+    size_t bucket_count;
+    size_t size;
+} cuckoo_table;
+
+/**
+ * Allocates dynamically an empty cuckoo table.
+ * @param allocator allocates the table and its buckets, NULL for calloc and
+ * free. It must outlive the table.
+ * @param bucket_count the number of buckets, a power of 2.
+ * @return pointer to dynamically allocated table, NULL upon failure.
+ */
+cuckoo_table *cuckoo_alloc (const hashmap_allocator *allocator,
+                            size_t bucket_count);
+
+/**
+ * Frees a cuckoo table and the pairs it holds.
+ * @param p_table pointer to dynamically allocated pointer to table.
+ */
+void cuckoo_free (cuckoo_table **p_table);
+
+/**
+ * Frees all the pairs of a cuckoo table, keeping its buckets.
+ * @param table
+ */
+void cuckoo_clear (cuckoo_table *table);
+
+/**
+ * @param current a bucket
+ * @return the number of pairs in the bucket
+ */
+size_t cuckoo_bucket_size (const cuckoo_bucket *current);
+
+/**
+ * Finds key in the table.
+ * @param table
+ * @param key
+ * @param hash full hash of key.
+ * @param key_cmp_calls incremented for every key_cmp call, may be NULL.
+ * @param p_position if not NULL, set to the position of the pair (for
+ * cuckoo_erase) when it is found.
+ * @return the pair holding key, NULL if not found.
+ */
+pair *cuckoo_find (const cuckoo_table *table, const_keyT key, size_t hash,
+                   size_t *key_cmp_calls, size_t *p_position);
+
+/**
+ * Inserts a pair (whose hash is cached) to the table, displacing other pairs
+ * to their alternative buckets if both of its buckets are full.
+ * @param table
+ * @param new_pair dynamically allocated pair, the table takes ownership of
+ * it upon success.
+ * @return 1 upon success, 0 if no room was found within CUCKOO_MAX_KICKS
+ * displacements (the table is left untouched and should grow).
+ */
+int cuckoo_insert (cuckoo_table *table, pair *new_pair);
+
+/**
+ * Erases (and frees) the pair at the given position.
+ * @param table
+ * @param position position set by cuckoo_find.
+ */
+void cuckoo_erase (cuckoo_table *table, size_t position);
+
+/**
+ * Moves all the pairs to a new number of buckets.
+ * @param table
+ * @param bucket_count the new number of buckets, a power of 2.
+ * @return 1 upon success 0 upon failure (the table is left untouched).
+ */
+int cuckoo_rehash (cuckoo_table *table, size_t bucket_count);
+
+#endif //CUCKOO_H_
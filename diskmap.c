@@ -0,0 +1,500 @@
+#include <string.h>
+#include "diskmap.h"
+
+#define ZERO 0
+#define ONE 1
+#define FAIL 0
+#define SUCCESS 1
+#define NEGATIVE -1
+#define PAGE_DEPTH 0
+#define PAGE_COUNT 1
+#define PAGE_HEADER (2 * sizeof (size_t))
+
+/**
+ * reads a field of a page's header
+ * @param data the page
+ * @param field PAGE_DEPTH or PAGE_COUNT
+ * @return the field
+ */
+size_t page_field (const unsigned char *data, size_t field)
+{
+  size_t value;
+  memcpy (&value, data + field * sizeof (size_t), sizeof (size_t));
+  return value;
+}
+
+/**
+ * writes a field of a page's header
+ * @param data the page
+ * @param field PAGE_DEPTH or PAGE_COUNT
+ * @param value
+ */
+void set_page_field (unsigned char *data, size_t field, size_t value)
+{
+  memcpy (data + field * sizeof (size_t), &value, sizeof (size_t));
+}
+
+/**
+ * @param map
+ * @param data a page
+ * @param i
+ * @return the i'th slot of the page: its hash, key and value
+ */
+unsigned char *page_slot (const diskmap *map, unsigned char *data, size_t i)
+{
+  return data + PAGE_HEADER + i * map->slot_size;
+}
+
+/**
+ * @param slot
+ * @return the hash cached in the slot
+ */
+size_t slot_hash (const unsigned char *slot)
+{
+  size_t hash;
+  memcpy (&hash, slot, sizeof (size_t));
+  return hash;
+}
+
+/**
+ * writes a page of the cache to the file
+ * @param map
+ * @param frame
+ * @return 1 upon success 0 upon failure
+ */
+int write_frame (diskmap *map, diskmap_frame *frame)
+{
+  if (fseek (map->file, (long) (frame->page * DISKMAP_PAGE_SIZE), SEEK_SET)
+      != ZERO
+      || fwrite (frame->data, DISKMAP_PAGE_SIZE, ONE, map->file) != ONE)
+    {
+      return FAIL;
+    }
+  map->page_writes++;
+  frame->dirty = ZERO;
+  return SUCCESS;
+}
+
+/**
+ * finds the cache frame of a page, or frees the least recently used frame
+ * for it (writing it back if it changed)
+ * @param map
+ * @param page
+ * @param p_cached set to 1 if the page is cached already, 0 otherwise
+ * @return the frame, NULL upon failure
+ */
+diskmap_frame *frame_for (diskmap *map, size_t page, int *p_cached)
+{
+  diskmap_frame *victim = &map->frames[ZERO];
+  for (size_t i = ZERO; i < map->frame_count; i++)
+    {
+      if (map->frames[i].page == page)
+        {
+          *p_cached = ONE;
+          map->frames[i].used = ++map->tick;
+          return &map->frames[i];
+        }
+      if (map->frames[i].used < victim->used)
+        {
+          victim = &map->frames[i];
+        }
+    }
+  if (victim->page != DISKMAP_NO_PAGE && victim->dirty
+      && write_frame (map, victim) == FAIL)
+    {
+      return NULL;
+    }
+  *p_cached = ZERO;
+  victim->page = page;
+  victim->dirty = ZERO;
+  victim->used = ++map->tick;
+  return victim;
+}
+
+/**
+ * gets a page through the cache, reading it from the file if needed
+ * @param map
+ * @param page
+ * @return the data of the page (valid until the next page is got), NULL
+ * upon failure
+ */
+unsigned char *get_page (diskmap *map, size_t page)
+{
+  int cached;
+  diskmap_frame *frame = frame_for (map, page, &cached);
+  if (frame == NULL)
+    {
+      return NULL;
+    }
+  if (!cached)
+    {
+      if (fseek (map->file, (long) (page * DISKMAP_PAGE_SIZE), SEEK_SET)
+          != ZERO
+          || fread (frame->data, DISKMAP_PAGE_SIZE, ONE, map->file) != ONE)
+        {
+          frame->page = DISKMAP_NO_PAGE;
+          frame->used = ZERO;
+          return NULL;
+        }
+      map->page_reads++;
+    }
+  return frame->data;
+}
+
+/**
+ * marks a page got by get_page (or new_page) as changed
+ * @param map
+ * @param page
+ */
+void touch_page (diskmap *map, size_t page)
+{
+  for (size_t i = ZERO; i < map->frame_count; i++)
+    {
+      if (map->frames[i].page == page)
+        {
+          map->frames[i].dirty = ONE;
+          return;
+        }
+    }
+}
+
+/**
+ * appends a new empty page to the file, in the cache
+ * @param map
+ * @param local_depth the depth of the page
+ * @return the number of the page, DISKMAP_NO_PAGE upon failure
+ */
+size_t new_page (diskmap *map, size_t local_depth)
+{
+  int cached;
+  diskmap_frame *frame = frame_for (map, map->page_count, &cached);
+  if (frame == NULL)
+    {
+      return DISKMAP_NO_PAGE;
+    }
+  memset (frame->data, ZERO, DISKMAP_PAGE_SIZE);
+  set_page_field (frame->data, PAGE_DEPTH, local_depth);
+  frame->dirty = ONE;
+  return map->page_count++;
+}
+
+/**
+ * Allocates dynamically a new empty disk map.
+ * @param path the file of the pages, it is created (or truncated). NULL for
+ * an anonymous temporary file.
+ * @param func a function which "hashes" keys.
+ * @param key_size, value_size the sizes of the keys and values, a page must
+ * hold at least two pairs.
+ * @param cache_pages the number of pages cached in memory, at least
+ * DISKMAP_MIN_CACHE_PAGES.
+ * @return pointer to dynamically allocated disk map, NULL upon failure.
+ */
+diskmap *diskmap_alloc (const char *path, hash_func func, size_t key_size,
+                        size_t value_size, size_t cache_pages)
+{
+  size_t slot_size = sizeof (size_t) + key_size + value_size;
+  if (func == NULL || key_size == ZERO || value_size == ZERO
+      || slot_size * 2 > DISKMAP_PAGE_SIZE - PAGE_HEADER
+      || cache_pages < DISKMAP_MIN_CACHE_PAGES)
+    {
+      return NULL;
+    }
+  diskmap *map = (diskmap *) calloc (ONE, sizeof (diskmap));
+  if (map == NULL)
+    {
+      return NULL;
+    }
+  map->file = path != NULL ? fopen (path, "w+b") : tmpfile ();
+  map->directory = (size_t *) malloc (sizeof (size_t));
+  map->frames = (diskmap_frame *) calloc (cache_pages,
+                                          sizeof (diskmap_frame));
+  map->frame_count = map->frames != NULL ? cache_pages : ZERO;
+  int failed = map->file == NULL || map->directory == NULL
+               || map->frames == NULL;
+  for (size_t i = ZERO; i < map->frame_count; i++)
+    {
+      map->frames[i].page = DISKMAP_NO_PAGE;
+      map->frames[i].data = (unsigned char *) malloc (DISKMAP_PAGE_SIZE);
+      failed = failed || map->frames[i].data == NULL;
+    }
+  map->hash_func = func;
+  map->key_size = key_size;
+  map->value_size = value_size;
+  map->slot_size = slot_size;
+  map->page_slots = (DISKMAP_PAGE_SIZE - PAGE_HEADER) / slot_size;
+  if (failed || (map->directory[ZERO] = new_page (map, ZERO))
+                == DISKMAP_NO_PAGE)
+    {
+      diskmap_free (&map);
+      return NULL;
+    }
+  return map;
+}
+
+/**
+ * Writes the changed cached pages to the file.
+ * @param map
+ * @return 1 upon success, 0 upon an I/O failure.
+ */
+int diskmap_flush (diskmap *map)
+{
+  if (map == NULL)
+    {
+      return FAIL;
+    }
+  for (size_t i = ZERO; i < map->frame_count; i++)
+    {
+      if (map->frames[i].page != DISKMAP_NO_PAGE && map->frames[i].dirty
+          && write_frame (map, &map->frames[i]) == FAIL)
+        {
+          return FAIL;
+        }
+    }
+  return fflush (map->file) == ZERO;
+}
+
+/**
+ * Flushes and closes the file of a disk map, and frees it. The file itself
+ * is not removed.
+ * @param p_map pointer to dynamically allocated pointer to disk map.
+ */
+void diskmap_free (diskmap **p_map)
+{
+  if (p_map == NULL || *p_map == NULL)
+    {
+      return;
+    }
+  diskmap *map = *p_map;
+  if (map->file != NULL)
+    {
+      diskmap_flush (map);
+      fclose (map->file);
+    }
+  for (size_t i = ZERO; i < map->frame_count; i++)
+    {
+      free (map->frames[i].data);
+    }
+  free (map->frames);
+  free (map->directory);
+  free (map);
+  *p_map = NULL;
+}
+
+/**
+ * @param map
+ * @param hash
+ * @return the page of the bucket of hash
+ */
+size_t page_of (const diskmap *map, size_t hash)
+{
+  return map->directory[hash & (((size_t) ONE << map->global_depth) - ONE)];
+}
+
+/**
+ * finds key in a page, comparing cached hashes before the keys
+ * @param map
+ * @param data the page
+ * @param key
+ * @param hash full hash of key
+ * @return index of the slot of key in the page, -1 if not found
+ */
+long find_in_page (const diskmap *map, unsigned char *data, const_keyT key,
+                   size_t hash)
+{
+  size_t count = page_field (data, PAGE_COUNT);
+  for (size_t i = ZERO; i < count; i++)
+    {
+      const unsigned char *slot = page_slot (map, data, i);
+      if (slot_hash (slot) == hash
+          && memcmp (slot + sizeof (size_t), key, map->key_size) == ZERO)
+        {
+          return (long) i;
+        }
+    }
+  return NEGATIVE;
+}
+
+/**
+ * doubles the directory, so it is indexed by one more hash bit
+ * @param map
+ * @return 1 upon success 0 upon failure
+ */
+int double_directory (diskmap *map)
+{
+  size_t entries = (size_t) ONE << map->global_depth;
+  size_t *directory = (size_t *) realloc (map->directory,
+                                          2 * entries * sizeof (size_t));
+  if (directory == NULL)
+    {
+      return FAIL;
+    }
+  memcpy (directory + entries, directory, entries * sizeof (size_t));
+  map->directory = directory;
+  map->global_depth++;
+  return SUCCESS;
+}
+
+/**
+ * splits a full page in two by the next hash bit, doubling the directory if
+ * needed
+ * @param map
+ * @param page
+ * @return 1 upon success 0 upon failure
+ */
+int split_page (diskmap *map, size_t page)
+{
+  unsigned char *data = get_page (map, page);
+  if (data == NULL)
+    {
+      return FAIL;
+    }
+  size_t depth = page_field (data, PAGE_DEPTH);
+  if (depth >= DISKMAP_MAX_DEPTH
+      || (depth == map->global_depth && double_directory (map) == FAIL))
+    {
+      return FAIL;
+    }
+  size_t sibling = new_page (map, depth + ONE);
+  // both pages stay cached, they are the two most recently used
+  unsigned char *sibling_data = sibling != DISKMAP_NO_PAGE
+                                ? get_page (map, sibling) : NULL;
+  data = sibling_data != NULL ? get_page (map, page) : NULL;
+  if (data == NULL)
+    {
+      return FAIL;
+    }
+  size_t bit = (size_t) ONE << depth;
+  size_t count = page_field (data, PAGE_COUNT);
+  size_t kept = ZERO;
+  size_t moved = ZERO;
+  for (size_t i = ZERO; i < count; i++)
+    {
+      unsigned char *slot = page_slot (map, data, i);
+      unsigned char *target = slot_hash (slot) & bit
+                              ? page_slot (map, sibling_data, moved++)
+                              : page_slot (map, data, kept++);
+      if (target != slot)
+        {
+          memcpy (target, slot, map->slot_size);
+        }
+    }
+  set_page_field (data, PAGE_DEPTH, depth + ONE);
+  set_page_field (data, PAGE_COUNT, kept);
+  set_page_field (sibling_data, PAGE_COUNT, moved);
+  touch_page (map, page);
+  touch_page (map, sibling);
+  for (size_t i = ZERO; i < ((size_t) ONE << map->global_depth); i++)
+    {
+      if (map->directory[i] == page && (i & bit))
+        {
+          map->directory[i] = sibling;
+        }
+    }
+  return SUCCESS;
+}
+
+/**
+ * Inserts (a copy of) key and value to the disk map.
+ * @param map
+ * @param key, value key_size and value_size bytes.
+ * @return 1 for successful insertion, 0 if key is in the map already or
+ * upon failure.
+ */
+int diskmap_insert (diskmap *map, const_keyT key, const_valueT value)
+{
+  if (map == NULL || key == NULL || value == NULL)
+    {
+      return FAIL;
+    }
+  size_t hash = map->hash_func (key);
+  while (ONE)
+    {
+      size_t page = page_of (map, hash);
+      unsigned char *data = get_page (map, page);
+      if (data == NULL || find_in_page (map, data, key, hash) != NEGATIVE)
+        {
+          return FAIL;
+        }
+      size_t count = page_field (data, PAGE_COUNT);
+      if (count < map->page_slots)
+        {
+          unsigned char *slot = page_slot (map, data, count);
+          memcpy (slot, &hash, sizeof (size_t));
+          memcpy (slot + sizeof (size_t), key, map->key_size);
+          memcpy (slot + sizeof (size_t) + map->key_size, value,
+                  map->value_size);
+          set_page_field (data, PAGE_COUNT, count + ONE);
+          touch_page (map, page);
+          map->size++;
+          return SUCCESS;
+        }
+      if (split_page (map, page) == FAIL)
+        {
+          return FAIL;
+        }
+    }
+}
+
+/**
+ * Looks key up in the disk map. The value is copied out, since the page
+ * holding it may leave the cache.
+ * @param map
+ * @param key key_size bytes.
+ * @param value_out filled with the value_size bytes of the value if key is
+ * found, may be NULL.
+ * @return 1 if key is found, 0 otherwise.
+ */
+int diskmap_at (diskmap *map, const_keyT key, valueT value_out)
+{
+  if (map == NULL || key == NULL)
+    {
+      return FAIL;
+    }
+  size_t hash = map->hash_func (key);
+  unsigned char *data = get_page (map, page_of (map, hash));
+  long location = data != NULL ? find_in_page (map, data, key, hash)
+                               : NEGATIVE;
+  if (location == NEGATIVE)
+    {
+      return FAIL;
+    }
+  if (value_out != NULL)
+    {
+      memcpy (value_out, page_slot (map, data, (size_t) location)
+                         + sizeof (size_t) + map->key_size, map->value_size);
+    }
+  return SUCCESS;
+}
+
+/**
+ * Erases key from the disk map. Pages are never merged back.
+ * @param map
+ * @param key key_size bytes.
+ * @return 1 if key was erased, 0 if it is not in the map or upon failure.
+ */
+int diskmap_erase (diskmap *map, const_keyT key)
+{
+  if (map == NULL || key == NULL)
+    {
+      return FAIL;
+    }
+  size_t hash = map->hash_func (key);
+  size_t page = page_of (map, hash);
+  unsigned char *data = get_page (map, page);
+  long location = data != NULL ? find_in_page (map, data, key, hash)
+                               : NEGATIVE;
+  if (location == NEGATIVE)
+    {
+      return FAIL;
+    }
+  size_t last = page_field (data, PAGE_COUNT) - ONE;
+  if ((size_t) location != last)
+    {
+      memcpy (page_slot (map, data, (size_t) location),
+              page_slot (map, data, last), map->slot_size);
+    }
+  set_page_field (data, PAGE_COUNT, last);
+  touch_page (map, page);
+  map->size--;
+  return SUCCESS;
+}
@@ -0,0 +1,144 @@
+#ifndef DISKMAP_H_
+#define DISKMAP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hashmap.h"
+
+/**
+ * @def DISKMAP_PAGE_SIZE
+ * The size (in bytes) of a page of the file, the unit of I/O. A page holds
+ * the pairs of one bucket.
+ */
+#define DISKMAP_PAGE_SIZE 4096UL
+
+/**
+ * @def DISKMAP_MIN_CACHE_PAGES
+ * The minimal number of pages cached in memory (a split needs two).
+ */
+#define DISKMAP_MIN_CACHE_PAGES 2UL
+
+/**
+ * @def DISKMAP_MAX_DEPTH
+ * The maximal number of hash bits the directory is indexed by. Inserting
+ * to a full page of pairs which share that many low hash bits fails.
+ */
+#define DISKMAP_MAX_DEPTH 32UL
+
+/**
+ * @def DISKMAP_NO_PAGE
+ * The page number of a cache frame which holds no page.
+ */
+#define DISKMAP_NO_PAGE ((size_t) -1)
+
+/**
+ * @struct diskmap_frame - a page cached in memory.
+ * @param page the number of the page held, DISKMAP_NO_PAGE if none.
+ * @param dirty 1 if the page changed since it was last written.
+ * @param used the tick of the last use of the page, the least recently used
+ * page is evicted first.
+ * @param data DISKMAP_PAGE_SIZE bytes of the page.
+ */
+typedef struct diskmap_frame {
+    size_t page;
+    int dirty;
+    unsigned long long used;
+    unsigned char *data;
+} diskmap_frame;
+
+/**
+ * @struct diskmap - a hash map of fixed-size plain keys and values (copied
+ * and compared bytewise) whose buckets are pages of a file, found by
+ * extendible hashing: a directory in memory maps the low global_depth bits
+ * of a hash to a page, and a full page splits in two (doubling the
+ * directory when it is indexed by as many bits as the page), so every
+ * operation reads and writes O(1) pages whatever the size of the map.
+ * @param file the file holding the pages.
+ * @param hash_func a function which "hashes" keys.
+ * @param key_size, value_size the sizes of the keys and values.
+ * @param slot_size the size of a pair in a page (hash, key and value).
+ * @param page_slots the number of pairs a page holds.
+ * @param directory 2^global_depth page numbers.
+ * @param global_depth the number of hash bits the directory is indexed by.
+ * @param page_count the number of pages of the file.
+ * @param size the number of pairs in the map.
+ * @param frames, frame_count the page cache.
+ * @param tick the clock of the page cache.
+ * @param page_reads, page_writes number of pages read from and written to
+ * the file.
+ */
+typedef struct diskmap {
+    FILE *file;
+    hash_func hash_func;
+    size_t key_size;
+    size_t value_size;
+    size_t slot_size;
+    size_t page_slots;
+    size_t *directory;
+    size_t global_depth;
+    size_t page_count;
+    size_t size;
+    diskmap_frame *frames;
+    size_t frame_count;
+    unsigned long long tick;
+    size_t page_reads;
+    size_t page_writes;
+} diskmap;
+
+/**
+ * Allocates dynamically a new empty disk map.
+ * @param path the file of the pages, it is created (or truncated). NULL for
+ * an anonymous temporary file.
+ * @param func a function which "hashes" keys.
+ * @param key_size, value_size the sizes of the keys and values, a page must
+ * hold at least two pairs.
+ * @param cache_pages the number of pages cached in memory, at least
+ * DISKMAP_MIN_CACHE_PAGES.
+ * @return pointer to dynamically allocated disk map, NULL upon failure.
+ */
+diskmap *diskmap_alloc (const char *path, hash_func func, size_t key_size,
+                        size_t value_size, size_t cache_pages);
+
+/**
+ * Writes the changed cached pages to the file.
+ * @param map
+ * @return 1 upon success, 0 upon an I/O failure.
+ */
+int diskmap_flush (diskmap *map);
+
+/**
+ * Flushes and closes the file of a disk map, and frees it. The file itself
+ * is not removed.
+ * @param p_map pointer to dynamically allocated pointer to disk map.
+ */
+void diskmap_free (diskmap **p_map);
+
+/**
+ * Inserts (a copy of) key and value to the disk map.
+ * @param map
+ * @param key, value key_size and value_size bytes.
+ * @return 1 for successful insertion, 0 if key is in the map already or
+ * upon failure.
+ */
+int diskmap_insert (diskmap *map, const_keyT key, const_valueT value);
+
+/**
+ * Looks key up in the disk map. The value is copied out, since the page
+ * holding it may leave the cache.
+ * @param map
+ * @param key key_size bytes.
+ * @param value_out filled with the value_size bytes of the value if key is
+ * found, may be NULL.
+ * @return 1 if key is found, 0 otherwise.
+ */
+int diskmap_at (diskmap *map, const_keyT key, valueT value_out);
+
+/**
+ * Erases key from the disk map. Pages are never merged back.
+ * @param map
+ * @param key key_size bytes.
+ * @return 1 if key was erased, 0 if it is not in the map or upon failure.
+ */
+int diskmap_erase (diskmap *map, const_keyT key);
+
+#endif //DISKMAP_H_
@@ -14,57 +14,285 @@ typedef struct Employee{
 #define HASHFUNCS_H_
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
+#include "hashmap.h"
 
 #define ZERO 0
 
+/**
+ * @def HASH_P0, HASH_P1, HASH_P2, HASH_P3
+ * Odd 64-bit constants (wyhash primes) used to mix the input.
+ */
+#define HASH_P0 0xa0761d6478bd642fULL
+#define HASH_P1 0xe7037ed1a0b428dbULL
+#define HASH_P2 0x8ebc6af09c88c6e3ULL
+#define HASH_P3 0x589965cc75374cc3ULL
+
+/**
+ * @def HASH_DEFAULT_SEED
+ * The seed of the unseeded hash funcs.
+ */
+#define HASH_DEFAULT_SEED 0x2d358dccaa6c78a5ULL
+
+/**
+ * @def HASH_LANES, HASH_LANE_BYTES, HASH_BLOCK_BYTES
+ * Long strings are consumed in blocks of HASH_LANES independent lanes of
+ * HASH_LANE_BYTES each, which the compiler can keep in flight (and
+ * vectorize) in parallel.
+ */
+#define HASH_LANES 4
+#define HASH_LANE_BYTES 16
+#define HASH_BLOCK_BYTES (HASH_LANES * HASH_LANE_BYTES)
+
+/**
+ * Multiplies a and b into 128 bits and folds the halves together.
+ */
+uint64_t hash_mum (uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+  __uint128_t r = (__uint128_t) a * b;
+  return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+  uint64_t a_hi = a >> 32, a_lo = (uint32_t) a;
+  uint64_t b_hi = b >> 32, b_lo = (uint32_t) b;
+  uint64_t hi = a_hi * b_hi, lo = a_lo * b_lo;
+  uint64_t mid_1 = a_hi * b_lo, mid_2 = a_lo * b_hi;
+  uint64_t carry = ((lo >> 32) + (uint32_t) mid_1 + (uint32_t) mid_2) >> 32;
+  hi += (mid_1 >> 32) + (mid_2 >> 32) + carry;
+  lo += (mid_1 << 32) + (mid_2 << 32);
+  return lo ^ hi;
+#endif
+}
+
+/**
+ * Reads 8 unaligned bytes.
+ */
+uint64_t hash_read64 (const unsigned char *p)
+{
+  uint64_t v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+/**
+ * Reads 4 unaligned bytes.
+ */
+uint64_t hash_read32 (const unsigned char *p)
+{
+  uint32_t v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+/**
+ * Hashes len bytes starting at data (wyhash-style).
+ */
+uint64_t hash_bytes (const void *data, size_t len, uint64_t seed)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  const uint64_t total = len;
+  uint64_t h = seed ^ hash_mum (seed ^ HASH_P0, HASH_P1);
+  uint64_t a = ZERO, b = ZERO;
+  if (len > HASH_BLOCK_BYTES)
+    {
+      const uint64_t primes[HASH_LANES] = {HASH_P0, HASH_P1, HASH_P2,
+                                           HASH_P3};
+      uint64_t lanes[HASH_LANES] = {h, h ^ HASH_P1, h ^ HASH_P2, h ^ HASH_P3};
+      do
+        {
+          for (int k = ZERO; k < HASH_LANES; k++)
+            {
+              const unsigned char *lane = p + k * HASH_LANE_BYTES;
+              lanes[k] = hash_mum (hash_read64 (lane) ^ primes[k],
+                                   hash_read64 (lane + 8) ^ lanes[k]);
+            }
+          p += HASH_BLOCK_BYTES;
+          len -= HASH_BLOCK_BYTES;
+        }
+      while (len > HASH_BLOCK_BYTES);
+      h = lanes[0] ^ lanes[1] ^ lanes[2] ^ lanes[3];
+    }
+  while (len > HASH_LANE_BYTES)
+    {
+      h = hash_mum (hash_read64 (p) ^ HASH_P1, hash_read64 (p + 8) ^ h);
+      p += HASH_LANE_BYTES;
+      len -= HASH_LANE_BYTES;
+    }
+  if (len >= 8)
+    {
+      a = hash_read64 (p);
+      b = hash_read64 (p + len - 8);
+    }
+  else if (len >= 4)
+    {
+      a = hash_read32 (p);
+      b = hash_read32 (p + len - 4);
+    }
+  else if (len > ZERO)
+    {
+      a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8)
+          | p[len - 1];
+    }
+  return hash_mum (HASH_P1 ^ total, hash_mum (a ^ HASH_P1, b ^ h));
+}
+
+/**
+ * Mixes a single 64-bit word.
+ */
+uint64_t hash_word (uint64_t word)
+{
+  return hash_mum (word ^ HASH_P0, HASH_DEFAULT_SEED ^ HASH_P1);
+}
+
+/**
+ * Combines the hash of another field into hash (for composite keys).
+ */
+size_t hash_combine (size_t hash, size_t field_hash)
+{
+  return (size_t) hash_mum ((uint64_t) hash ^ HASH_P2,
+                            (uint64_t) field_hash ^ HASH_P3);
+}
+
+/**
+ * @def SIP_C0, SIP_C1, SIP_C2, SIP_C3
+ * SipHash initialization constants ("somepseudorandomlygeneratedbytes").
+ */
+#define SIP_C0 0x736f6d6570736575ULL
+#define SIP_C1 0x646f72616e646f6dULL
+#define SIP_C2 0x6c7967656e657261ULL
+#define SIP_C3 0x7465646279746573ULL
+#define SIP_FINAL 0xffULL
+
+/**
+ * Rotates x left by b bits.
+ */
+uint64_t hash_rotl (uint64_t x, int b)
+{
+  return (x << b) | (x >> (64 - b));
+}
+
+/**
+ * A single SipRound on the state v.
+ */
+void hash_sipround (uint64_t v[4])
+{
+  v[0] += v[1];
+  v[1] = hash_rotl (v[1], 13);
+  v[1] ^= v[0];
+  v[0] = hash_rotl (v[0], 32);
+  v[2] += v[3];
+  v[3] = hash_rotl (v[3], 16);
+  v[3] ^= v[2];
+  v[0] += v[3];
+  v[3] = hash_rotl (v[3], 21);
+  v[3] ^= v[0];
+  v[2] += v[1];
+  v[1] = hash_rotl (v[1], 17);
+  v[1] ^= v[2];
+  v[2] = hash_rotl (v[2], 32);
+}
+
+/**
+ * Reads 8 bytes as a little endian word.
+ */
+uint64_t hash_read64_le (const unsigned char *p, size_t len)
+{
+  uint64_t word = ZERO;
+  for (size_t i = ZERO; i < len; i++)
+    {
+      word |= (uint64_t) p[i] << (8 * i);
+    }
+  return word;
+}
+
+/**
+ * SipHash-1-3 of len bytes starting at data, keyed with seed.
+ */
+uint64_t hash_siphash13 (const void *data, size_t len,
+                         const hashmap_seed *seed)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  uint64_t v[4] = {seed->k0 ^ SIP_C0, seed->k1 ^ SIP_C1,
+                   seed->k0 ^ SIP_C2, seed->k1 ^ SIP_C3};
+  uint64_t last = (uint64_t) len << 56;
+  for (; len >= 8; p += 8, len -= 8)
+    {
+      uint64_t word = hash_read64_le (p, 8);
+      v[3] ^= word;
+      hash_sipround (v);
+      v[0] ^= word;
+    }
+  last |= hash_read64_le (p, len);
+  v[3] ^= last;
+  hash_sipround (v);
+  v[0] ^= last;
+  v[2] ^= SIP_FINAL;
+  hash_sipround (v);
+  hash_sipround (v);
+  hash_sipround (v);
+  return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+/**
+ * Integers keyed hash func.
+ */
+size_t hash_int_keyed (const void *elem, const hashmap_seed *seed)
+{
+  return (size_t) hash_siphash13 (elem, sizeof (int), seed);
+}
 
 /**
- * Integers simple hash func.
+ * String keyed hash func.
+ */
+size_t hash_string_keyed (const void *elem, const hashmap_seed *seed)
+{
+  const char *str = ((const char *) elem);
+  return (size_t) hash_siphash13 (str, strlen (str), seed);
+}
+
+/**
+ * Integers hash func.
  */
 size_t hash_int(const void *elem){
-    size_t hash = *((int *) elem);
+    size_t hash = (size_t) hash_word ((uint64_t) *((int *) elem));
     return hash;
 }
 
 /**
- * Longs simple hash func.
+ * Longs hash func.
  */
 size_t hash_long(const void *elem){
-  size_t hash = (long) elem;
+  size_t hash = (size_t) hash_word ((uint64_t) (long) elem);
   return hash;
 }
 
 /**
- * Chars simple hash func.
+ * Chars hash func.
  */
 size_t hash_char(const void *elem){
-    size_t hash = *((unsigned char *) elem);
+    size_t hash = (size_t) hash_word (*((unsigned char *) elem));
     return hash;
 }
 
 /**
- * String simple hash func.
+ * String hash func.
  */
 
 size_t hash_string(const void *elem){
-  char *str = ((char *) elem);
-  size_t hash = ZERO;
-  for (int i=ZERO; i<(int)strlen(str); i++)
-    {
-      hash += (size_t) str[i];
-    }
-  return hash;
+  const char *str = ((const char *) elem);
+  return (size_t) hash_bytes (str, strlen (str), HASH_DEFAULT_SEED);
 }
 
 /**
- * Employee simple hash func.
+ * Employee hash func.
  */
 size_t hash_employee(const void *elem)
 {
   Employee *new_employee = ((Employee *) elem);
-  return (hash_long((const void *)new_employee->ID) + hash_long((const void *)
-  new_employee->salary) + hash_string((const void *) new_employee->name));
+  size_t hash = hash_long ((const void *) new_employee->ID);
+  hash = hash_combine (hash, hash_long ((const void *) new_employee->salary));
+  return hash_combine (hash, hash_string ((const void *) new_employee->name));
 }
 
 #endif // HASHFUNCS_H_
\ No newline at end of file
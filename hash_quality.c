@@ -0,0 +1,200 @@
+/**
+ * Hash quality report.
+ * Usage: hash_quality [string|int|long|char] [buckets] < keys.txt
+ * Reads one key per line from stdin, hashes it with the matching hash func
+ * of hash_funcs.h and reports the full-hash collision rate and the bucket
+ * distribution the hash map would get. buckets defaults to the capacity a
+ * hashmap holding all the keys would have.
+ */
+#include <stdio.h>
+#include <string.h>
+#include "hash_funcs.h"
+#include "hashmap.h"
+
+#define ZERO 0
+#define ONE 1
+#define FAIL 0
+#define SUCCESS 1
+#define LINE_LEN 4096
+#define KEYS_INITIAL_CAP 1024UL
+#define HISTOGRAM_LEN 8UL
+
+/**
+ * @struct key_set - the keys read from the input.
+ */
+typedef struct key_set {
+    char **keys;
+    size_t size;
+    size_t capacity;
+} key_set;
+
+/**
+ * reads all the lines of stream into set
+ * @return 1 upon success 0 upon failure
+ */
+int read_keys (FILE *stream, key_set *set)
+{
+  char line[LINE_LEN];
+  while (fgets (line, LINE_LEN, stream) != NULL)
+    {
+      line[strcspn (line, "\r\n")] = '\0';
+      if (set->size == set->capacity)
+        {
+          size_t capacity = set->capacity ? set->capacity * 2
+                                          : KEYS_INITIAL_CAP;
+          char **keys = realloc (set->keys, capacity * sizeof (char *));
+          if (keys == NULL)
+            {
+              return FAIL;
+            }
+          set->keys = keys;
+          set->capacity = capacity;
+        }
+      size_t len = strlen (line) + ONE;
+      set->keys[set->size] = malloc (len);
+      if (set->keys[set->size] == NULL)
+        {
+          return FAIL;
+        }
+      memcpy (set->keys[set->size++], line, len);
+    }
+  return SUCCESS;
+}
+
+/**
+ * hashes a key read as text with the hash func of type
+ */
+size_t hash_key (const char *type, const char *key)
+{
+  if (strcmp (type, "int") == ZERO)
+    {
+      int num = (int) strtol (key, NULL, 10);
+      return hash_int (&num);
+    }
+  if (strcmp (type, "long") == ZERO)
+    {
+      return hash_long ((const void *) strtol (key, NULL, 10));
+    }
+  if (strcmp (type, "char") == ZERO)
+    {
+      return hash_char (key);
+    }
+  return hash_string (key);
+}
+
+/**
+ * compares two hashes for qsort
+ */
+int cmp_hash (const void *a, const void *b)
+{
+  size_t hash_1 = *(const size_t *) a, hash_2 = *(const size_t *) b;
+  return (hash_1 > hash_2) - (hash_1 < hash_2);
+}
+
+/**
+ * @return the capacity a hashmap holding n keys would have
+ */
+size_t default_buckets (size_t n)
+{
+  size_t buckets = HASH_MAP_INITIAL_CAP;
+  while ((double) n / buckets > HASH_MAP_MAX_LOAD_FACTOR)
+    {
+      buckets *= HASH_MAP_GROWTH_FACTOR;
+    }
+  return buckets;
+}
+
+/**
+ * prints the report for the hashes of n keys over buckets
+ * @return 1 upon success 0 upon failure
+ */
+int report (size_t *hashes, size_t n, size_t buckets)
+{
+  size_t *chains = calloc (buckets, sizeof (size_t));
+  if (chains == NULL)
+    {
+      return FAIL;
+    }
+  for (size_t i = ZERO; i < n; i++)
+    {
+      chains[hashes[i] & (buckets - ONE)]++;
+    }
+  size_t used = ZERO, max_chain = ZERO;
+  size_t histogram[HISTOGRAM_LEN] = {ZERO};
+  double expected = (double) n / buckets, chi_square = ZERO;
+  for (size_t i = ZERO; i < buckets; i++)
+    {
+      used += chains[i] > ZERO;
+      max_chain = chains[i] > max_chain ? chains[i] : max_chain;
+      histogram[chains[i] < HISTOGRAM_LEN ? chains[i]
+                                          : HISTOGRAM_LEN - ONE]++;
+      chi_square += (chains[i] - expected) * (chains[i] - expected);
+    }
+  chi_square /= expected > ZERO ? expected : ONE;
+  qsort (hashes, n, sizeof (size_t), cmp_hash);
+  size_t distinct = n > ZERO;
+  for (size_t i = ONE; i < n; i++)
+    {
+      distinct += hashes[i] != hashes[i - ONE];
+    }
+  printf ("keys %lu\n", (unsigned long) n);
+  printf ("distinct_hashes %lu\n", (unsigned long) distinct);
+  printf ("hash_collision_rate %.6f\n",
+          n > ZERO ? (double) (n - distinct) / n : ZERO);
+  printf ("buckets %lu\n", (unsigned long) buckets);
+  printf ("used_buckets %lu\n", (unsigned long) used);
+  printf ("max_chain %lu\n", (unsigned long) max_chain);
+  printf ("mean_chain %.3f\n", used > ZERO ? (double) n / used : ZERO);
+  printf ("chi_square %.1f (uniform ~ %lu)\n", chi_square,
+          (unsigned long) (buckets - ONE));
+  for (size_t i = ZERO; i < HISTOGRAM_LEN; i++)
+    {
+      printf ("chain_%lu%s %lu\n", (unsigned long) i,
+              i == HISTOGRAM_LEN - ONE ? "+" : "",
+              (unsigned long) histogram[i]);
+    }
+  free (chains);
+  return SUCCESS;
+}
+
+int main (int argc, char *argv[])
+{
+  const char *type = argc > ONE ? argv[ONE] : "string";
+  if (strcmp (type, "string") != ZERO && strcmp (type, "int") != ZERO
+      && strcmp (type, "long") != ZERO && strcmp (type, "char") != ZERO)
+    {
+      fprintf (stderr, "Usage: %s [string|int|long|char] [buckets] < keys\n",
+               argv[ZERO]);
+      return EXIT_FAILURE;
+    }
+  key_set set = {NULL, ZERO, ZERO};
+  size_t *hashes = NULL;
+  int status = EXIT_FAILURE;
+  if (read_keys (stdin, &set))
+    {
+      size_t buckets = argc > 2 ? strtoul (argv[2], NULL, 10)
+                                : default_buckets (set.size);
+      hashes = malloc ((set.size + ONE) * sizeof (size_t));
+      if (hashes != NULL && buckets > ZERO
+          && (buckets & (buckets - ONE)) == ZERO)
+        {
+          for (size_t i = ZERO; i < set.size; i++)
+            {
+              hashes[i] = hash_key (type, set.keys[i]);
+            }
+          status = report (hashes, set.size, buckets) ? EXIT_SUCCESS
+                                                      : EXIT_FAILURE;
+        }
+      else
+        {
+          fprintf (stderr, "buckets must be a power of 2\n");
+        }
+    }
+  for (size_t i = ZERO; i < set.size; i++)
+    {
+      free (set.keys[i]);
+    }
+  free (set.keys);
+  free (hashes);
+  return status;
+}
@@ -1,3 +1,12 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <sys/random.h>
+#endif
 #include "hashmap.h"
 
 #define ZERO 0
@@ -5,7 +14,16 @@
 #define FAIL 0
 #define SUCCESS 1
 #define NEGATIVE -1
-#define HALF 0.5
+#define MIX_SHIFT 33
+#define MIX_MUL_1 0xff51afd7ed558ccdULL
+#define MIX_MUL_2 0xc4ceb9fe1a85ec53ULL
+#define RANDOM_SOURCE "/dev/urandom"
+#define SEED_STEP 0x9E3779B97F4A7C15ULL
+#define KEY_NONE 0
+#define KEY_DRAWING 1
+#define KEY_DRAWN 2
+#define NANO 1e9
+#define SPILL_TAG ((uintptr_t) 1)
 
 /**
  * Allocates dynamically new hash map element.
@@ -15,460 +33,2475 @@
  */
 hashmap *hashmap_alloc (hash_func func)
 {
-  if (func == NULL)
-    {
-      return NULL;
-    }
-  hashmap *new_map = (hashmap *) malloc (sizeof (hashmap));
-  if (new_map == NULL)
-    {
-      return NULL;
-    }
-  vector **new_buckets = (vector **) calloc (HASH_MAP_INITIAL_CAP,
-                                             sizeof(vector *));
-  if (new_buckets == NULL)
-    {
-      free (new_map);
-      return NULL;
-    }
-  new_map->size = ZERO;
-  new_map->capacity = HASH_MAP_INITIAL_CAP;
-  new_map->buckets = new_buckets;
-  new_map->hash_func = func;
-  return new_map;
+  return hashmap_alloc_config (func, NULL);
 }
+
 /**
- * calculates the hash for specific key
- * @param hash_map
- * @param key
- * @return hashed key
+ * murmur3 finalizer, every input bit affects every output bit
+ * @param hash
+ * @return mixed hash
  */
-size_t get_hash (const hashmap *hash_map, const_keyT key)
+size_t mix_hash (size_t hash)
 {
-  return (hash_map->hash_func (key)) & (hash_map->capacity - ONE);
+  unsigned long long mixed = hash;
+  mixed ^= mixed >> MIX_SHIFT;
+  mixed *= MIX_MUL_1;
+  mixed ^= mixed >> MIX_SHIFT;
+  mixed *= MIX_MUL_2;
+  mixed ^= mixed >> MIX_SHIFT;
+  return (size_t) mixed;
 }
 
 /**
- * swaps buckets for specific pair during resize of capacity
- * @param hash_map
- * @param data pair
- * @param new_buckets the new bucket
- * @return 1 upon success 0 upon failure
+ * draws a random key from the system's random source (getrandom where
+ * available, RANDOM_SOURCE otherwise)
+ * @param key the key to be filled
+ * @return 1 upon success 0 if no random source is available
  */
-int bucket_swap (hashmap *hash_map, const pair *data, vector **new_buckets)
+int system_random (hashmap_seed *key)
 {
-  size_t ind = get_hash (hash_map, data->key);
-  int new = ZERO;
-  if (new_buckets[ind] == NULL)
+#ifdef __linux__
+  if (getrandom (key, sizeof (hashmap_seed), ZERO)
+      == (ssize_t) sizeof (hashmap_seed))
     {
-      vector *new_vec = vector_alloc (pair_copy, pair_cmp, pair_free);
-      if (new_vec == NULL)
-        {
-          return FAIL;
-        }
-      new = ONE;
-      new_buckets[ind] = new_vec;
+      return SUCCESS;
     }
-  if (vector_push_back (new_buckets[ind], data) == ZERO)
+#endif
+  FILE *source = fopen (RANDOM_SOURCE, "rb");
+  if (source == NULL)
     {
-      if (new == ONE)
-        {
-          vector_free (&new_buckets[ind]);
-          new_buckets[ind] = NULL;
-        }
       return FAIL;
     }
-  return SUCCESS;
+  size_t read = fread (key, sizeof (hashmap_seed), ONE, source);
+  fclose (source);
+  return read == ONE;
 }
+
 /**
- * Frees a hash map and the elements the hash map itself allocated.
- * @param p_hash_map pointer to dynamically allocated pointer to hash_map.
+ * draws a random seed for a map. The process draws a random key once, and
+ * every map's seed is derived from it and a map counter, so allocating a
+ * keyed map makes no system call. The counter and the key are updated
+ * atomically, so maps may be allocated concurrently. Without a random
+ * source, the time, the processor time and an address are mixed instead.
+ * @param seed the seed to be filled
+ * @param salt an address which differs between maps
  */
-void hashmap_free (hashmap **p_hash_map)
+void random_seed (hashmap_seed *seed, const void *salt)
 {
-  if (p_hash_map == NULL || *p_hash_map == NULL)
+  static hashmap_seed process_key;
+  static int key_state = KEY_NONE;
+  static unsigned long long counter = ZERO;
+  unsigned long long count = __atomic_add_fetch (&counter, ONE,
+                                                 __ATOMIC_RELAXED);
+  hashmap_seed key;
+  if (__atomic_load_n (&key_state, __ATOMIC_ACQUIRE) == KEY_DRAWN)
     {
-      return;
+      key = process_key;
     }
-  for (size_t i = ZERO; i < (*p_hash_map)->capacity; i++)
+  else if (system_random (&key) == SUCCESS)
     {
-      if ((*p_hash_map)->buckets[i] == NULL)
+      // the first thread to draw a key publishes it, the others use theirs
+      int expected = KEY_NONE;
+      if (__atomic_compare_exchange_n (&key_state, &expected, KEY_DRAWING,
+                                       ZERO, __ATOMIC_ACQUIRE,
+                                       __ATOMIC_RELAXED))
         {
-          continue;
+          process_key = key;
+          __atomic_store_n (&key_state, KEY_DRAWN, __ATOMIC_RELEASE);
         }
-      vector_free (&(*p_hash_map)->buckets[i]);
-      (*p_hash_map)->buckets[i] = NULL;
     }
-  free ((*p_hash_map)->buckets);
-  free ((*p_hash_map));
-  (*p_hash_map) = NULL;
+  else
+    {
+      key.k0 = mix_hash ((size_t) time (NULL) ^ (size_t) salt);
+      key.k1 = mix_hash ((size_t) clock () ^ (size_t) key.k0);
+    }
+  // mix_hash is a bijection, so distinct counts give distinct seeds
+  seed->k0 = mix_hash ((size_t) (key.k0 + count * SEED_STEP));
+  seed->k1 = mix_hash ((size_t) (key.k1 ^ mix_hash ((size_t) count)));
 }
+
 /**
- * frees buckets
- * @param bucket vector pointer to pointer
- * @param hash_map
+ * @return the time of a monotonic wall clock, in seconds
  */
-void free_buckets (vector **bucket, hashmap *hash_map)
+double monotonic_seconds (void)
 {
-  for (size_t i = ZERO; i < hash_map->capacity; i++)
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (double) now.tv_sec + (double) now.tv_nsec / NANO;
+}
+
+/**
+ * the default clock of TTLs
+ * @return the current time in seconds
+ */
+unsigned long long default_clock (void)
+{
+  return (unsigned long long) time (NULL);
+}
+
+/**
+ * @param capacity number of index slots of a compact table
+ * @return the number of entries the compact table holds, as many as the
+ * hash map may hold at that capacity
+ */
+size_t compact_entry_cap (size_t capacity)
+{
+  return (size_t) (capacity * HASH_MAP_MAX_LOAD_FACTOR);
+}
+
+/**
+ * allocates zeroed memory with an allocator
+ * @param allocator
+ * @param size
+ * @return the memory, NULL upon failure
+ */
+void *allocate (const hashmap_allocator *allocator, size_t size)
+{
+  return allocator->allocate (allocator->ctx, size);
+}
+
+/**
+ * frees memory allocated with an allocator
+ * @param allocator
+ * @param memory may be NULL
+ * @param size the size memory was allocated with
+ */
+void deallocate (const hashmap_allocator *allocator, void *memory,
+                 size_t size)
+{
+  if (memory != NULL)
     {
-      if (bucket[i] != NULL)
-        {
-          vector_free (&bucket[i]);
-        }
+      allocator->deallocate (allocator->ctx, memory, size);
     }
-  free (bucket);
 }
+
 /**
- * resizes buckets when capacity changes
- * @param hash_map
- * @param size old size of map
- * @return new buckets for hashmap
+ * Allocates dynamically new hash map element with optional behaviours.
+ * @param func a function which "hashes" keys, may be NULL if
+ * config->keyed_hash is set.
+ * @param config the behaviours of the hash map, NULL for the defaults.
+ * @return pointer to dynamically allocated hashmap.
+ * @if_fail return NULL.
  */
-vector **resize_hashmap (hashmap *hash_map, size_t size)
+hashmap *hashmap_alloc_config (hash_func func, const hashmap_config *config)
 {
-  if (hash_map == NULL)
+  if ((func == NULL && (config == NULL || config->keyed_hash == NULL))
+      || (config != NULL && config->max_bytes > ZERO
+          && config->entry_size == NULL)
+      || (config != NULL && config->allocator != NULL
+          && (config->allocator->allocate == NULL
+              || config->allocator->deallocate == NULL)))
     {
       return NULL;
     }
-  vector **new_buckets = (vector **) calloc (hash_map->capacity,
-                                             sizeof (vector *));
-  if (new_buckets == NULL)
+  hashmap_allocator allocator = config != NULL && config->allocator != NULL
+                                ? *config->allocator : allocator_default ();
+  hashmap *new_map = (hashmap *) allocate (&allocator, sizeof (hashmap));
+  if (new_map == NULL)
     {
       return NULL;
     }
-  for (size_t i = ZERO; i < size; i++)
+  // the backends keep a pointer to the map's copy of the allocator
+  new_map->allocator = allocator;
+  int multimap = config != NULL && config->multimap;
+  int use_cuckoo = config != NULL && config->cuckoo && !multimap;
+  int use_compact = config != NULL && config->compact && !use_cuckoo
+                    && !multimap;
+  int use_filter = config != NULL && config->bloom_filter && !use_cuckoo
+                   && !use_compact;
+  bucket *new_buckets = use_cuckoo || use_compact ? NULL : (bucket *) allocate
+      (&allocator, HASH_MAP_INITIAL_CAP * sizeof (bucket));
+  cuckoo_table *table = use_cuckoo ? cuckoo_alloc
+      (&new_map->allocator, HASH_MAP_INITIAL_CAP / CUCKOO_BUCKET_SLOTS) : NULL;
+  compact_table *dense = use_compact ? compact_alloc
+      (&new_map->allocator, HASH_MAP_INITIAL_CAP,
+       compact_entry_cap (HASH_MAP_INITIAL_CAP)) : NULL;
+  int use_counters = config != NULL && config->counters;
+  hashmap_counters *counters = use_counters ? (hashmap_counters *) allocate
+      (&allocator, sizeof (hashmap_counters)) : NULL;
+  bloom *filter = use_filter ? bloom_alloc (&new_map->allocator,
+                                            HASH_MAP_INITIAL_CAP) : NULL;
+  int use_lru = config != NULL && (config->max_entries > ZERO
+                                   || config->max_bytes > ZERO);
+  hashmap_lru *lru = use_lru ? (hashmap_lru *) allocate
+      (&allocator, sizeof (hashmap_lru)) : NULL;
+  if ((new_buckets == NULL && table == NULL && dense == NULL)
+      || (use_counters && counters == NULL)
+      || (use_filter && filter == NULL) || (use_lru && lru == NULL))
     {
-      if (hash_map->buckets[i] == NULL)
-        {
-          continue;
-        }
-      for (size_t j = ZERO; j < hash_map->buckets[i]->size; j++)
-        {
-          if (bucket_swap (hash_map, (const pair *) vector_at
-              (hash_map->buckets[i], j), new_buckets) == FAIL)
-            {
-              free_buckets (new_buckets, hash_map);
-              return NULL;
-            }
-        }
+      deallocate (&allocator, new_buckets,
+                  HASH_MAP_INITIAL_CAP * sizeof (bucket));
+      cuckoo_free (&table);
+      compact_free (&dense);
+      deallocate (&allocator, counters, sizeof (hashmap_counters));
+      bloom_free (&filter);
+      deallocate (&allocator, lru, sizeof (hashmap_lru));
+      deallocate (&allocator, new_map, sizeof (hashmap));
+      return NULL;
+    }
+  new_map->types = NULL;
+  new_map->type_count = ZERO;
+  new_map->size = ZERO;
+  new_map->capacity = HASH_MAP_INITIAL_CAP;
+  new_map->buckets = new_buckets;
+  new_map->cuckoo = table;
+  new_map->compact = dense;
+  new_map->hash_func = func;
+  new_map->counters = counters;
+  new_map->filter = filter;
+  new_map->lru = lru;
+  new_map->max_entries = use_lru ? config->max_entries : ZERO;
+  new_map->max_bytes = use_lru ? config->max_bytes : ZERO;
+  new_map->entry_size = use_lru ? config->entry_size : NULL;
+  new_map->clock = config != NULL && config->clock != NULL ? config->clock
+                                                           : default_clock;
+  new_map->wheel = NULL;
+  new_map->multimap = multimap;
+  new_map->mix_hash = config != NULL && config->mix_hash;
+  new_map->keyed_hash = config != NULL ? config->keyed_hash : NULL;
+  new_map->seed.k0 = ZERO;
+  new_map->seed.k1 = ZERO;
+  if (new_map->keyed_hash != NULL && config->seed != NULL)
+    {
+      new_map->seed = *config->seed;
+    }
+  else if (new_map->keyed_hash != NULL)
+    {
+      random_seed (&new_map->seed, new_map);
     }
-  return new_buckets;
+  return new_map;
 }
 
 /**
- * gets location of key in vector
- * @param key
- * @param temp pointer to pointer of vectors
- * @param ind index of vector
- * @return index of key in vector
+ * @param hash_map
+ * @return the key_cmp counter of the hash map, NULL if it has no counters
  */
-int get_location (const void *key, vector **temp, size_t ind)
+size_t *cmp_counter (const hashmap *hash_map)
 {
-  if (temp[ind] == NULL)
+  return hash_map->counters != NULL ? &hash_map->counters->key_cmp_calls
+                                    : NULL;
+}
+
+/**
+ * counts a key_cmp call, if the hash map has counters
+ * @param hash_map
+ */
+void count_key_cmp (const hashmap *hash_map)
+{
+  if (hash_map->counters != NULL)
     {
-      return NEGATIVE;
+      hash_map->counters->key_cmp_calls++;
     }
-  for (size_t i = ZERO; i < temp[ind]->size; i++)
+}
+
+/**
+ * calculates the full (unmasked) hash for specific key, which is cached in
+ * the pairs
+ * @param hash_map
+ * @param key
+ * @return full hash of key
+ */
+size_t get_full_hash (const hashmap *hash_map, const_keyT key)
+{
+  size_t hash = hash_map->keyed_hash != NULL
+                ? hash_map->keyed_hash (key, &hash_map->seed)
+                : hash_map->hash_func (key);
+  if (hash_map->mix_hash)
     {
-      pair *data = vector_at ((const vector *) temp[ind], (size_t) i);
-      if (data == NULL)
-        {
-          return NEGATIVE;
-        }
-      if (data->key_cmp (data->key, key) == ONE)
-        {
-          return i;
-        }
+      hash = mix_hash (hash);
     }
-  return NEGATIVE;
+  return hash;
 }
 
 /**
- * reverts condensed bucket after resize
- * @param hash_map
- * @param temp
- * @param new_bucket_size 1 upon resize 0 upon no resize
- * @return 0
+ * compares the cached hashes of two pairs, for sorting buckets
+ * @param p1 pointer to pointer to pair
+ * @param p2 pointer to pointer to pair
+ * @return negative, 0 or positive as in qsort
+ */
+int cmp_pair_hash (const void *p1, const void *p2)
+{
+  size_t hash_1 = (*(pair *const *) p1)->hash;
+  size_t hash_2 = (*(pair *const *) p2)->hash;
+  return (hash_1 > hash_2) - (hash_1 < hash_2);
+}
+
+/**
+ * @param current a bucket
+ * @return the spill array of the bucket, NULL if it did not spill
+ */
+bucket_spill *bucket_spilled (const bucket *current)
+{
+  uintptr_t slot = (uintptr_t) current->slot;
+  return slot & SPILL_TAG ? (bucket_spill *) (slot & ~SPILL_TAG) : NULL;
+}
+
+/**
+ * @param current a bucket
+ * @return the number of pairs in the bucket
  */
-int revert_condensed_bucket (hashmap *hash_map, vector **temp, int
-new_bucket_size)
+size_t bucket_size (const bucket *current)
 {
-  if (new_bucket_size == ONE)
+  const bucket_spill *spill = bucket_spilled (current);
+  if (spill != NULL)
     {
-      free_buckets (temp, hash_map);
-      hash_map->capacity *= HASH_MAP_GROWTH_FACTOR;
+      return spill->size;
     }
-  hash_map->size++;
-  return FAIL;
+  return current->slot != NULL;
 }
 
 /**
- * checks inputs of insert function
+ * @param current a bucket
+ * @return the array of the bucket's pairs (the inline one or spilled)
+ */
+pair **bucket_pairs (const bucket *current)
+{
+  bucket_spill *spill = bucket_spilled (current);
+  return spill != NULL ? spill->pairs : (pair **) &current->slot;
+}
+
+/**
+ * sorts the pairs of a bucket by their cached hashes. The sort of a multimap
+ * is stable, so the pairs of a key stay adjacent (and in insertion order);
+ * its buckets are sorted runs already, so an insertion sort is cheap.
  * @param hash_map
- * @param in_pair pair being inserted
- * @return new pair upon success
+ * @param pairs
+ * @param size
  */
-int check_hashmap_insert_inputs (hashmap *hash_map, const pair *in_pair)
+void sort_bucket (const hashmap *hash_map, pair **pairs, size_t size)
 {
-  // check inputs
-  if (hash_map == NULL || in_pair == NULL || in_pair->key == NULL ||
-      in_pair->value == NULL)
+  if (!hash_map->multimap)
     {
-      return FAIL;
+      qsort (pairs, size, sizeof (pair *), cmp_pair_hash);
+      return;
     }
-  // check if key already in map
-  if (hashmap_at ((const hashmap *) hash_map, (const_keyT) in_pair->key) !=
-      NULL)
+  for (size_t i = ONE; i < size; i++)
     {
-      return FAIL;
+      pair *moved = pairs[i];
+      size_t j = i;
+      for (; j > ZERO && pairs[j - ONE]->hash > moved->hash; j--)
+        {
+          pairs[j] = pairs[j - ONE];
+        }
+      pairs[j] = moved;
     }
-  return SUCCESS;
 }
 
 /**
- * removes enlarged bucket after attempted resize
+ * moves a pair pushed to the back of a multimap's bucket right after the
+ * last pair of its key, so the pairs of a key stay adjacent
  * @param hash_map
- * @param new_pair pair being added
- * @param temp temporary buckets
- * @param new_bucket_size 1 upon resize 0 upon no resize
+ * @param current
  */
-void revert_enlarged_bucket (hashmap *hash_map, vector **temp,
-                             int new_bucket_size)
+void group_pushed_pair (const hashmap *hash_map, bucket *current)
 {
-  if (new_bucket_size == ONE)
+  size_t size = bucket_size (current);
+  pair **pairs = bucket_pairs (current);
+  pair *pushed = pairs[size - ONE];
+  size_t i = size - ONE;
+  while (i > ZERO)
     {
-      if (temp != NULL)
+      const pair *other = pairs[i - ONE];
+      if (other->hash == pushed->hash)
         {
-          free_buckets (temp, hash_map);
-          temp = NULL;
+          count_key_cmp (hash_map);
+          if (other->type->key_cmp (other->key, pushed->key) == ONE)
+            {
+              break;
+            }
         }
-      hash_map->capacity /= HASH_MAP_GROWTH_FACTOR;
+      i--;
     }
-  hash_map->size--;
+  if (i == ZERO)
+    {
+      return;
+    }
+  for (size_t j = size - ONE; j > i; j--)
+    {
+      pairs[j] = pairs[j - ONE];
+    }
+  pairs[i] = pushed;
 }
 
 /**
- * restores hashmap after attempted insert failure
+ * keeps a treeified bucket sorted after a pair was pushed to its back (or
+ * grouped by group_pushed_pair)
  * @param hash_map
- * @param new_pair pair that failed to be inserted
- * @param temp
- * @param new_bucket_size 1 upon resize 0 upon no resize
- * @param is_new_vector 1 upon new vector 0 upon no resize
- * @param ind index of vector
- * @return 0
+ * @param current
  */
-int vector_push_back_fail (hashmap *hash_map, vector **temp, int
-new_bucket_size, int is_new_vector, size_t ind)
+void sort_pushed_pair (const hashmap *hash_map, bucket *current)
 {
-  if (is_new_vector == ONE)
+  size_t size = bucket_size (current);
+  pair **pairs = bucket_pairs (current);
+  if (size == HASH_MAP_TREEIFY_THRESHOLD)
+    {
+      sort_bucket (hash_map, pairs, size);
+      return;
+    }
+  if (size < HASH_MAP_TREEIFY_THRESHOLD)
+    {
+      return;
+    }
+  pair *pushed = pairs[size - ONE];
+  size_t i = size - ONE;
+  for (; i > ZERO && pairs[i - ONE]->hash > pushed->hash; i--)
     {
-      vector_free (&temp[ind]);
+      pairs[i] = pairs[i - ONE];
     }
-  revert_enlarged_bucket (hash_map, temp, new_bucket_size);
-  return FAIL;
+  pairs[i] = pushed;
 }
 
 /**
- * removes old buckets after successful insert
- * @param hash_map
- * @param temp buckets
- * @param new_bucket_size 1 upon resize 0 upon no resize
- * @param num
- * @return 1
+ * @param capacity
+ * @return the size of a spill array with room for capacity pairs
+ */
+size_t spill_bytes (size_t capacity)
+{
+  return sizeof (bucket_spill) + capacity * sizeof (pair *);
+}
+
+/**
+ * makes a bucket point to its spill array
+ * @param current
+ * @param spill
+ */
+void set_spill (bucket *current, bucket_spill *spill)
+{
+  current->slot = (pair *) ((uintptr_t) spill | SPILL_TAG);
+}
+
+/**
+ * gives a bucket a spill array with room for capacity pairs, moving its pair
+ * to it
+ * @param allocator the allocator of the hash map
+ * @param current a bucket which did not spill
+ * @param capacity at least HASH_MAP_SPILL_INITIAL_CAP
+ * @return 1 upon success 0 upon failure
  */
-int remove_old_bucket (hashmap *hash_map, vector **temp, int
-new_bucket_size, double num)
+int spill_bucket (const hashmap_allocator *allocator, bucket *current,
+                  size_t capacity)
 {
-  if (new_bucket_size == ONE)
+  if (capacity > UINT32_MAX)
     {
-      vector **old = hash_map->buckets;
-      hash_map->buckets = temp;
-      hash_map->capacity = (size_t) hash_map->capacity * num;
-      free_buckets (old, hash_map);
-      hash_map->capacity = (size_t) hash_map->capacity / num;
+      return FAIL;
+    }
+  bucket_spill *spill = (bucket_spill *) allocate (allocator,
+                                                   spill_bytes (capacity));
+  if (spill == NULL)
+    {
+      return FAIL;
     }
+  spill->size = ZERO;
+  spill->capacity = (uint32_t) capacity;
+  if (current->slot != NULL)
+    {
+      spill->pairs[spill->size++] = current->slot;
+    }
+  set_spill (current, spill);
   return SUCCESS;
 }
 
 /**
- * Inserts a new in_pair to the hash map.
- * The function inserts *new*, *copied*, *dynamically allocated* in_pair,
- * NOT the in_pair it receives as a parameter.
- * @param hash_map the hash map to be inserted with new element.
- * @param in_pair a in_pair the hash map would contain.
- * @return returns 1 for successful insertion, 0 otherwise.
+ * resizes the spill array of a bucket
+ * @param allocator the allocator of the hash map
+ * @param current a spilled bucket
+ * @param capacity at least the size of the bucket
+ * @return 1 upon success 0 upon failure (the bucket is left untouched)
  */
-int hashmap_insert (hashmap *hash_map, const pair *in_pair)
+int resize_spill (const hashmap_allocator *allocator, bucket *current,
+                  size_t capacity)
 {
-  int good_inputs = check_hashmap_insert_inputs (hash_map, in_pair);
-  if (good_inputs == FAIL)
+  if (capacity > UINT32_MAX)
     {
       return FAIL;
     }
-  hash_map->size++;
-  vector **temp = hash_map->buckets;
-  int new_bucket_size = ZERO;
-  int is_new_vector = ZERO;
-  if (hashmap_get_load_factor ((const hashmap *) hash_map) >
-      HASH_MAP_MAX_LOAD_FACTOR)
-    {
-      hash_map->capacity *= HASH_MAP_GROWTH_FACTOR;
-      temp = resize_hashmap (hash_map,
-                             hash_map->capacity / HASH_MAP_GROWTH_FACTOR);
-      new_bucket_size = ONE;
-      if (temp == NULL)
-        {
-          revert_enlarged_bucket (hash_map, temp, new_bucket_size);
-          return FAIL;
-        }
+  bucket_spill *old_spill = bucket_spilled (current);
+  bucket_spill *spill = (bucket_spill *) allocate (allocator,
+                                                   spill_bytes (capacity));
+  if (spill == NULL)
+    {
+      return FAIL;
+    }
+  memcpy (spill, old_spill, spill_bytes (old_spill->size));
+  spill->capacity = (uint32_t) capacity;
+  deallocate (allocator, old_spill, spill_bytes (old_spill->capacity));
+  set_spill (current, spill);
+  return SUCCESS;
+}
+
+/**
+ * adds a pair to the back of a bucket, the bucket takes ownership of it
+ * @param allocator the allocator of the hash map
+ * @param current
+ * @param new_pair dynamically allocated pair, with its hash cached
+ * @return 1 upon success 0 upon failure
+ */
+int bucket_push (const hashmap_allocator *allocator, bucket *current,
+                 pair *new_pair)
+{
+  if (current->slot == NULL)
+    {
+      current->slot = new_pair;
+      return SUCCESS;
     }
-  size_t ind = get_hash ((const hashmap *) hash_map,(const_keyT) in_pair->key);
-  if (temp[ind] == NULL)
+  bucket_spill *spill = bucket_spilled (current);
+  if (spill == NULL)
     {
-      vector *new_vec = vector_alloc (pair_copy, pair_cmp, pair_free);
-      if (new_vec == NULL)
+      if (spill_bucket (allocator, current, HASH_MAP_SPILL_INITIAL_CAP)
+          == FAIL)
         {
-          revert_enlarged_bucket (hash_map, temp, new_bucket_size);
           return FAIL;
         }
-      temp[ind] = new_vec;
-      is_new_vector = ONE;
     }
-  if (vector_push_back (temp[ind], in_pair) == ZERO)
+  else if (spill->size == spill->capacity
+           && resize_spill (allocator, current,
+                            spill->capacity * HASH_MAP_GROWTH_FACTOR) == FAIL)
     {
-      return vector_push_back_fail (hash_map, temp, new_bucket_size,
-                                    is_new_vector, ind);
+      return FAIL;
     }
-  return remove_old_bucket (hash_map, temp, new_bucket_size, HALF);
+  spill = bucket_spilled (current);
+  spill->pairs[spill->size++] = new_pair;
+  return SUCCESS;
 }
 
 /**
- * The function returns the value associated with the given key.
- * @param hash_map a hash map.
- * @param key the key to be checked.
- * @return the value associated with key if exists, NULL otherwise (the value
- * itself, not a copy of it).
+ * erases (and frees) the pair at the given index of a bucket. The last pair
+ * takes its place, unless the bucket is treeified and must stay sorted. The
+ * spill array shrinks with the bucket, and a bucket left with a single pair
+ * holds it inline again.
+ * @param allocator the allocator of the hash map
+ * @param current
+ * @param ind
+ * @param keep_order 1 to keep the order of the other pairs anyway
  */
-valueT hashmap_at (const hashmap *hash_map, const_keyT key)
+void bucket_erase (const hashmap_allocator *allocator, bucket *current,
+                   size_t ind, int keep_order)
 {
-  if (hash_map == NULL || key == NULL)
+  bucket_spill *spill = bucket_spilled (current);
+  if (spill == NULL)
     {
-      return NULL;
+      pair_free ((void **) &current->slot);
+      return;
     }
-  size_t ind = get_hash (hash_map, key);
-  if (hash_map->buckets[ind] == NULL)
+  pair_free ((void **) &spill->pairs[ind]);
+  spill->size--;
+  if (keep_order || spill->size >= HASH_MAP_TREEIFY_THRESHOLD)
     {
-      return NULL;
+      memmove (&spill->pairs[ind], &spill->pairs[ind + ONE],
+               (spill->size - ind) * sizeof (pair *));
     }
-  for (size_t i = ZERO; i < hash_map->buckets[ind]->size; i++)
+  else
     {
-      pair *data = vector_at ((const vector *) hash_map->buckets[ind], (size_t)
-          i);
-      if (data == NULL)
-        {
-          return NULL;
-        }
-      if (data->key_cmp (data->key, key) == ONE)
-        {
-          return data->value;
-        }
+      spill->pairs[ind] = spill->pairs[spill->size];
+    }
+  if (spill->size <= ONE)
+    {
+      current->slot = spill->size == ONE ? spill->pairs[ZERO] : NULL;
+      deallocate (allocator, spill, spill_bytes (spill->capacity));
+      return;
+    }
+  if (spill->size * HASH_MAP_GROWTH_FACTOR * HASH_MAP_GROWTH_FACTOR
+      <= spill->capacity)
+    {
+      // may fail only to shrink, then the bucket keeps its room
+      resize_spill (allocator, current,
+                    spill->capacity / HASH_MAP_GROWTH_FACTOR);
     }
-  return NULL;
 }
+
 /**
- * The function erases the pair associated with key.
- * @param hash_map a hash map.
- * @param key a key of the pair to be erased.
- * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in
- * map, considered fail).
+ * frees all the pairs of a bucket and its spill array
+ * @param allocator the allocator of the hash map
+ * @param current
  */
-int hashmap_erase (hashmap *hash_map, const_keyT key)
+void bucket_free (const hashmap_allocator *allocator, bucket *current)
 {
-  if (hash_map == NULL || key == NULL)
+  bucket_spill *spill = bucket_spilled (current);
+  if (spill == NULL)
     {
-      return FAIL;
-    }
-  hash_map->size--;
-  vector **temp = hash_map->buckets;
-  int new_bucket_size = ZERO;
-  if (hashmap_get_load_factor (hash_map) < HASH_MAP_MIN_LOAD_FACTOR)
-    {
-      new_bucket_size = ONE;
-      hash_map->capacity /= HASH_MAP_GROWTH_FACTOR;
-      temp = resize_hashmap (hash_map,
-                             hash_map->capacity * HASH_MAP_GROWTH_FACTOR);
-      if (temp == NULL)
-        {
-          hash_map->size++;
-          hash_map->capacity *= HASH_MAP_GROWTH_FACTOR;
-          return FAIL;
-        }
+      pair_free ((void **) &current->slot);
+      return;
     }
-  size_t ind = get_hash ((const hashmap *) hash_map, (const_keyT) key);
-  int location = get_location (key, temp, ind);
-  if (location == NEGATIVE || vector_erase (temp[ind], (size_t) location) ==
-                              FAIL)
+  for (size_t i = ZERO; i < spill->size; i++)
     {
-      return revert_condensed_bucket (hash_map, temp, new_bucket_size);
+      pair_free ((void **) &spill->pairs[i]);
     }
-  return remove_old_bucket (hash_map, temp, new_bucket_size,
-                            HASH_MAP_GROWTH_FACTOR);
+  deallocate (allocator, spill, spill_bytes (spill->capacity));
+  current->slot = NULL;
 }
 
 /**
- * This function returns the load factor of the hash map.
- * @param hash_map a hash map.
- * @return the hash map's load factor, -1 if the function failed.
+ * empties a bucket without freeing its pairs (after they were moved)
+ * @param allocator the allocator of the hash map
+ * @param current
  */
-double hashmap_get_load_factor (const hashmap *hash_map)
+void bucket_release (const hashmap_allocator *allocator, bucket *current)
 {
-  if (hash_map == NULL)
+  bucket_spill *spill = bucket_spilled (current);
+  if (spill != NULL)
     {
-      return NEGATIVE;
+      deallocate (allocator, spill, spill_bytes (spill->capacity));
     }
-  return (double) hash_map->size / hash_map->capacity;
+  current->slot = NULL;
 }
+
 /**
- * This function receives a hashmap and 2 functions, the first checks a
- * condition on the keys, and the seconds apply some modification on the
- * values. The function should apply the modification
- * only on the values that are associated with keys that meet the condition.
- *
- * Example: if the hashmap maps char->int, keyT_func checks if the char is a
- * capital letter (A-Z), and val_t_func multiples the number by 2,
- * hashmap_apply_if will resize_hashmap the map:
- * {('C',2),('#',3),('X',5)}, to: {('C',4),('#',3),('X',10)},
- * and the return value will be 2.
- * @param hash_map a hashmap
- * @param keyT_func a function that checks a condition on keyT and return 1
- * if true, 0 else
- * @param valT_func a function that modifies valueT, in-place
- * @return number of changed values
+ * releases an array of buckets whose pairs were moved
+ * @param hash_map the hash map whose allocator allocated the buckets
+ * @param buckets
+ * @param capacity number of buckets
  */
-int hashmap_apply_if (const hashmap *hash_map, keyT_func keyT_func,
-                  valueT_func valT_func)
+void release_buckets (const hashmap *hash_map, bucket *buckets,
+                      size_t capacity)
 {
-  if (hash_map == NULL || keyT_func == NULL || valT_func == NULL)
+  for (size_t i = ZERO; i < capacity; i++)
     {
-      return NEGATIVE;
+      bucket_release (&hash_map->allocator, &buckets[i]);
     }
-  int count = ZERO;
-  for (size_t i = ZERO; i < hash_map->capacity; i++)
-    {
-      if (hash_map->buckets[i] == NULL)
-        {
-          continue;
-        }
-      for (size_t j = ZERO; j < hash_map->buckets[i]->size; j++)
-        {
-          if (keyT_func (((pair *) vector_at (hash_map->buckets[i], j))->key)
-              == ONE)
+  deallocate (&hash_map->allocator, buckets, capacity * sizeof (bucket));
+}
+
+/**
+ * finds key in a bucket, comparing cached hashes before calling key_cmp.
+ * Treeified buckets are binary searched.
+ * @param hash_map
+ * @param current
+ * @param key
+ * @param hash full hash of key
+ * @return index of key in bucket, -1 if not found
+ */
+int find_in_bucket (const hashmap *hash_map, const bucket *current,
+                    const_keyT key, size_t hash)
+{
+  size_t size = bucket_size (current);
+  pair **pairs = bucket_pairs (current);
+  int sorted = size >= HASH_MAP_TREEIFY_THRESHOLD;
+  size_t i = ZERO;
+  if (sorted)
+    {
+      size_t high = size;
+      while (i < high)
+        {
+          size_t mid = i + (high - i) / 2;
+          if (pairs[mid]->hash < hash)
+            {
+              i = mid + ONE;
+            }
+          else
+            {
+              high = mid;
+            }
+        }
+    }
+  for (; i < size; i++)
+    {
+      if (pairs[i]->hash != hash)
+        {
+          if (sorted)
+            {
+              return NEGATIVE;
+            }
+          continue;
+        }
+      count_key_cmp (hash_map);
+      if (pairs[i]->type->key_cmp (pairs[i]->key, key) == ONE)
+        {
+          return (int) i;
+        }
+    }
+  return NEGATIVE;
+}
+
+/**
+ * finds a given pair in a bucket
+ * @param current
+ * @param target
+ * @return index of target in bucket, -1 if not found
+ */
+int pair_in_bucket (const bucket *current, const pair *target)
+{
+  size_t size = bucket_size (current);
+  pair **pairs = bucket_pairs (current);
+  for (size_t i = ZERO; i < size; i++)
+    {
+      if (pairs[i] == target)
+        {
+          return (int) i;
+        }
+    }
+  return NEGATIVE;
+}
+
+/**
+ * @param hash_map
+ * @return the size of the prefix of every pair of the hash map: the
+ * lru_links of an LRU hash map, nothing otherwise
+ */
+size_t lru_prefix (const hashmap *hash_map)
+{
+  return hash_map->lru != NULL ? sizeof (lru_links) : ZERO;
+}
+
+/**
+ * @param entry a pair of an LRU hash map
+ * @return the recency links of the pair, right before it
+ */
+lru_links *links_of (pair *entry)
+{
+  return (lru_links *) entry - ONE;
+}
+
+/**
+ * @param hash_map
+ * @param entry a pair of the hash map
+ * @return the timer entry of the pair, at the start of its prefix, NULL if
+ * it was not inserted with a TTL
+ */
+timer_entry *timer_of (const hashmap *hash_map, const pair *entry)
+{
+  size_t prefix = entry->type->prefix;
+  return prefix > lru_prefix (hash_map)
+         ? (timer_entry *) ((unsigned char *) entry - prefix) : NULL;
+}
+
+/**
+ * @param hash_map
+ * @param timer the timer entry of a pair of the hash map
+ * @return the pair
+ */
+pair *timer_pair (const hashmap *hash_map, timer_entry *timer)
+{
+  return (pair *) ((unsigned char *) (timer + ONE) + lru_prefix (hash_map));
+}
+
+/**
+ * links a pair at the front (most recently used end) of the recency list
+ * @param lru
+ * @param entry an unlinked pair
+ */
+void lru_push_front (hashmap_lru *lru, pair *entry)
+{
+  links_of (entry)->prev = NULL;
+  links_of (entry)->next = lru->head;
+  if (lru->head != NULL)
+    {
+      links_of (lru->head)->prev = entry;
+    }
+  else
+    {
+      lru->tail = entry;
+    }
+  lru->head = entry;
+}
+
+/**
+ * unlinks a pair from the recency list
+ * @param lru
+ * @param entry a linked pair
+ */
+void lru_unlink (hashmap_lru *lru, pair *entry)
+{
+  lru_links *links = links_of (entry);
+  if (links->prev != NULL)
+    {
+      links_of (links->prev)->next = links->next;
+    }
+  else
+    {
+      lru->head = links->next;
+    }
+  if (links->next != NULL)
+    {
+      links_of (links->next)->prev = links->prev;
+    }
+  else
+    {
+      lru->tail = links->prev;
+    }
+  links->prev = NULL;
+  links->next = NULL;
+}
+
+/**
+ * makes a pair the most recently used one, if the hash map is an LRU cache
+ * @param hash_map
+ * @param entry a pair of the hash map
+ */
+void lru_touch (const hashmap *hash_map, pair *entry)
+{
+  if (hash_map->lru != NULL && hash_map->lru->head != entry)
+    {
+      lru_unlink (hash_map->lru, entry);
+      lru_push_front (hash_map->lru, entry);
+    }
+}
+
+/**
+ * links a new pair as the most recently used one, if the hash map is an LRU
+ * cache
+ * @param hash_map
+ * @param entry a pair just inserted to the hash map
+ */
+void lru_add (hashmap *hash_map, pair *entry)
+{
+  if (hash_map->lru == NULL)
+    {
+      return;
+    }
+  lru_push_front (hash_map->lru, entry);
+  if (hash_map->entry_size != NULL)
+    {
+      hash_map->lru->bytes += hash_map->entry_size (entry);
+    }
+}
+
+/**
+ * unlinks a pair about to be erased, if the hash map is an LRU cache
+ * @param hash_map
+ * @param entry a pair of the hash map
+ */
+void lru_remove (hashmap *hash_map, pair *entry)
+{
+  if (hash_map->lru == NULL)
+    {
+      return;
+    }
+  lru_unlink (hash_map->lru, entry);
+  if (hash_map->entry_size != NULL)
+    {
+      hash_map->lru->bytes -= hash_map->entry_size (entry);
+    }
+}
+
+/**
+ * links a pair just inserted to the hash map into its recency list and
+ * timer wheel
+ * @param hash_map
+ * @param entry
+ */
+void link_pair (hashmap *hash_map, pair *entry)
+{
+  lru_add (hash_map, entry);
+  timer_entry *timer = timer_of (hash_map, entry);
+  if (timer != NULL && timer->expires != ZERO)
+    {
+      timer_wheel_add (hash_map->wheel, timer);
+    }
+}
+
+/**
+ * unlinks a pair about to be erased from its recency list and timer wheel
+ * @param hash_map
+ * @param entry
+ */
+void unlink_pair (hashmap *hash_map, pair *entry)
+{
+  lru_remove (hash_map, entry);
+  timer_entry *timer = timer_of (hash_map, entry);
+  if (timer != NULL && timer->expires != ZERO)
+    {
+      timer_wheel_remove (hash_map->wheel, timer);
+    }
+}
+
+/**
+ * @param hash_map
+ * @param entry a pair of the hash map
+ * @return 1 if the pair was inserted with a TTL which is over, 0 otherwise
+ */
+int pair_expired (const hashmap *hash_map, const pair *entry)
+{
+  const timer_entry *timer = timer_of (hash_map, entry);
+  return timer != NULL && timer->expires != ZERO
+         && timer->expires <= hash_map->clock ();
+}
+
+/**
+ * finds the pair of key
+ * @param hash_map
+ * @param key
+ * @param hash full hash of key
+ * @return the pair holding key, NULL if not found
+ */
+pair *find_pair (const hashmap *hash_map, const_keyT key, size_t hash)
+{
+  if (hash_map->cuckoo != NULL)
+    {
+      return cuckoo_find (hash_map->cuckoo, key, hash,
+                          cmp_counter (hash_map), NULL);
+    }
+  if (hash_map->compact != NULL)
+    {
+      return compact_find (hash_map->compact, key, hash,
+                           cmp_counter (hash_map), NULL);
+    }
+  if (hash_map->filter != NULL
+      && bloom_may_contain (hash_map->filter, hash) == FAIL)
+    {
+      return NULL;
+    }
+  const bucket *current = &hash_map->buckets[hash
+                                             & (hash_map->capacity - ONE)];
+  int location = find_in_bucket (hash_map, current, key, hash);
+  if (location == NEGATIVE)
+    {
+      return NULL;
+    }
+  return bucket_pairs (current)[location];
+}
+
+/**
+ * Frees a hash map and the elements the hash map itself allocated.
+ * @param p_hash_map pointer to dynamically allocated pointer to hash_map.
+ */
+void hashmap_free (hashmap **p_hash_map)
+{
+  if (p_hash_map == NULL || *p_hash_map == NULL)
+    {
+      return;
+    }
+  for (size_t i = ZERO; (*p_hash_map)->buckets != NULL
+                        && i < (*p_hash_map)->capacity; i++)
+    {
+      bucket_free (&(*p_hash_map)->allocator, &(*p_hash_map)->buckets[i]);
+    }
+  const hashmap_allocator allocator = (*p_hash_map)->allocator;
+  deallocate (&allocator, (*p_hash_map)->buckets,
+              (*p_hash_map)->capacity * sizeof (bucket));
+  cuckoo_free (&(*p_hash_map)->cuckoo);
+  compact_free (&(*p_hash_map)->compact);
+  deallocate (&allocator, (*p_hash_map)->counters,
+              sizeof (hashmap_counters));
+  bloom_free (&(*p_hash_map)->filter);
+  deallocate (&allocator, (*p_hash_map)->lru, sizeof (hashmap_lru));
+  timer_wheel_free (&(*p_hash_map)->wheel);
+  for (size_t i = ZERO; i < (*p_hash_map)->type_count; i++)
+    {
+      deallocate (&allocator, (*p_hash_map)->types[i], sizeof (pair_type));
+    }
+  deallocate (&allocator, (*p_hash_map)->types,
+              (*p_hash_map)->type_count * sizeof (pair_type *));
+  deallocate (&allocator, *p_hash_map, sizeof (hashmap));
+  (*p_hash_map) = NULL;
+}
+
+/**
+ * Erases all the elements of a hash map, keeping its capacity so the map can
+ * be refilled without resizing.
+ * @param hash_map the hash map to be cleared.
+ */
+void hashmap_clear (hashmap *hash_map)
+{
+  if (hash_map == NULL)
+    {
+      return;
+    }
+  if (hash_map->lru != NULL)
+    {
+      memset (hash_map->lru, ZERO, sizeof (hashmap_lru));
+    }
+  if (hash_map->wheel != NULL)
+    {
+      timer_wheel_clear (hash_map->wheel);
+    }
+  if (hash_map->cuckoo != NULL)
+    {
+      cuckoo_clear (hash_map->cuckoo);
+      hash_map->size = ZERO;
+    }
+  if (hash_map->compact != NULL)
+    {
+      compact_clear (hash_map->compact);
+      hash_map->size = ZERO;
+    }
+  for (size_t i = ZERO; i < hash_map->capacity && hash_map->size > ZERO; i++)
+    {
+      hash_map->size -= bucket_size (&hash_map->buckets[i]);
+      bucket_free (&hash_map->allocator, &hash_map->buckets[i]);
+    }
+  hash_map->size = ZERO;
+  if (hash_map->filter != NULL)
+    {
+      bloom_clear (hash_map->filter);
+    }
+}
+
+/**
+ * resizes the buckets to a new capacity, moving the pairs (by their cached
+ * hash) without copying them
+ * @param hash_map
+ * @param capacity new number of buckets
+ * @return 1 upon success 0 upon failure (the hash map is left untouched)
+ */
+int resize_buckets (hashmap *hash_map, size_t capacity)
+{
+  bucket *new_buckets = (bucket *) allocate (&hash_map->allocator,
+                                             capacity * sizeof (bucket));
+  // the filter is rebuilt, dropping the hashes of erased keys
+  bloom *new_filter = hash_map->filter != NULL
+                      ? bloom_alloc (&hash_map->allocator, capacity) : NULL;
+  if (new_buckets == NULL || (hash_map->filter != NULL && new_filter == NULL))
+    {
+      deallocate (&hash_map->allocator, new_buckets,
+                  capacity * sizeof (bucket));
+      bloom_free (&new_filter);
+      return FAIL;
+    }
+  for (size_t i = ZERO; i < hash_map->capacity; i++)
+    {
+      size_t size = bucket_size (&hash_map->buckets[i]);
+      pair **pairs = bucket_pairs (&hash_map->buckets[i]);
+      for (size_t j = ZERO; j < size; j++)
+        {
+          if (bucket_push (&hash_map->allocator,
+                           &new_buckets[pairs[j]->hash & (capacity - ONE)],
+                           pairs[j]) == FAIL)
+            {
+              release_buckets (hash_map, new_buckets, capacity);
+              bloom_free (&new_filter);
+              return FAIL;
+            }
+          if (new_filter != NULL)
+            {
+              bloom_add (new_filter, pairs[j]->hash);
+            }
+        }
+    }
+  for (size_t i = ZERO; i < capacity; i++)
+    {
+      if (bucket_size (&new_buckets[i]) >= HASH_MAP_TREEIFY_THRESHOLD)
+        {
+          sort_bucket (hash_map, bucket_pairs (&new_buckets[i]),
+                       bucket_size (&new_buckets[i]));
+        }
+    }
+  release_buckets (hash_map, hash_map->buckets, hash_map->capacity);
+  hash_map->buckets = new_buckets;
+  if (new_filter != NULL)
+    {
+      bloom_free (&hash_map->filter);
+      hash_map->filter = new_filter;
+    }
+  return SUCCESS;
+}
+
+/**
+ * resizes the hash map to a new capacity (with either backend) and updates
+ * its counters
+ * @param hash_map
+ * @param capacity new capacity
+ * @return 1 upon success 0 upon failure (the hash map is left untouched)
+ */
+int resize_hashmap (hashmap *hash_map, size_t capacity)
+{
+  double start = hash_map->counters != NULL ? monotonic_seconds () : ZERO;
+  int resized;
+  if (hash_map->cuckoo != NULL)
+    {
+      resized = cuckoo_rehash (hash_map->cuckoo,
+                               capacity / CUCKOO_BUCKET_SLOTS);
+    }
+  else if (hash_map->compact != NULL)
+    {
+      resized = compact_rehash (hash_map->compact, capacity,
+                                compact_entry_cap (capacity));
+    }
+  else
+    {
+      resized = resize_buckets (hash_map, capacity);
+    }
+  if (resized == FAIL)
+    {
+      return FAIL;
+    }
+  if (hash_map->counters != NULL)
+    {
+      hash_map->counters->grows += capacity > hash_map->capacity;
+      hash_map->counters->shrinks += capacity < hash_map->capacity;
+      hash_map->counters->resize_seconds += monotonic_seconds () - start;
+    }
+  hash_map->capacity = capacity;
+  return SUCCESS;
+}
+
+/**
+ * @param hash_map
+ * @return the capacity under which the hash map's backend does not shrink
+ */
+size_t min_capacity (const hashmap *hash_map)
+{
+  if (hash_map->cuckoo != NULL)
+    {
+      return CUCKOO_BUCKET_SLOTS;
+    }
+  return hash_map->compact != NULL ? COMPACT_MIN_INDEX : ONE;
+}
+
+/**
+ * erases (and frees) a pair of key, without shrinking the hash map
+ * @param hash_map
+ * @param key
+ * @param hash full hash of key
+ * @param target the pair of key to erase, NULL for the first one
+ * @return 1 upon success 0 if key is not found (or upon failure)
+ */
+int remove_pair (hashmap *hash_map, const_keyT key, size_t hash,
+                 const pair *target)
+{
+  if (hash_map->filter != NULL
+      && bloom_may_contain (hash_map->filter, hash) == FAIL)
+    {
+      return FAIL;
+    }
+  if (hash_map->cuckoo != NULL)
+    {
+      size_t position;
+      pair *found = cuckoo_find (hash_map->cuckoo, key, hash,
+                                 cmp_counter (hash_map), &position);
+      if (found == NULL)
+        {
+          return FAIL;
+        }
+      unlink_pair (hash_map, found);
+      cuckoo_erase (hash_map->cuckoo, position);
+    }
+  else if (hash_map->compact != NULL)
+    {
+      size_t slot;
+      pair *found = compact_find (hash_map->compact, key, hash,
+                                  cmp_counter (hash_map), &slot);
+      if (found == NULL)
+        {
+          return FAIL;
+        }
+      unlink_pair (hash_map, found);
+      compact_erase (hash_map->compact, slot);
+    }
+  else
+    {
+      bucket *current = &hash_map->buckets[hash
+                                           & (hash_map->capacity - ONE)];
+      int location = target != NULL ? pair_in_bucket (current, target)
+                                    : find_in_bucket (hash_map, current, key,
+                                                      hash);
+      if (location == NEGATIVE)
+        {
+          return FAIL;
+        }
+      pair *found = bucket_pairs (current)[location];
+      unlink_pair (hash_map, found);
+      bucket_erase (&hash_map->allocator, current, (size_t) location,
+                    hash_map->multimap);
+    }
+  hash_map->size--;
+  return SUCCESS;
+}
+
+/**
+ * erases (and frees) a pair of key, shrinking the hash map if it got sparse
+ * @param hash_map
+ * @param key
+ * @param hash full hash of key
+ * @param target the pair of key to erase, NULL for the first one
+ * @return 1 upon success 0 if key is not found (or upon failure)
+ */
+int erase_pair (hashmap *hash_map, const_keyT key, size_t hash,
+                const pair *target)
+{
+  if (remove_pair (hash_map, key, hash, target) == FAIL)
+    {
+      return FAIL;
+    }
+  if (hashmap_get_load_factor (hash_map) < HASH_MAP_MIN_LOAD_FACTOR
+      && hash_map->capacity > min_capacity (hash_map))
+    {
+      // failing to shrink leaves a valid (sparser) hash map
+      resize_hashmap (hash_map, hash_map->capacity / HASH_MAP_GROWTH_FACTOR);
+    }
+  return SUCCESS;
+}
+
+/**
+ * finds the pair of key, reclaiming it if it expired
+ * @param hash_map
+ * @param key
+ * @param hash full hash of key
+ * @return the pair holding key, NULL if not found or expired
+ */
+pair *find_live_pair (hashmap *hash_map, const_keyT key, size_t hash)
+{
+  pair *found = find_pair (hash_map, key, hash);
+  if (found != NULL && pair_expired (hash_map, found))
+    {
+      erase_pair (hash_map, key, hash, found);
+      return NULL;
+    }
+  return found;
+}
+
+/**
+ * checks inputs of insert function
+ * @param hash_map
+ * @param in_pair pair being inserted
+ * @param p_hash set to the full hash of the pair's key upon success
+ * @return 1 upon success
+ */
+int check_hashmap_insert_inputs (hashmap *hash_map, const pair *in_pair,
+                                 size_t *p_hash)
+{
+  // check inputs
+  if (hash_map == NULL || in_pair == NULL || in_pair->key == NULL ||
+      pair_value (in_pair) == NULL)
+    {
+      return FAIL;
+    }
+  // check if key already in map, a multimap takes it again
+  size_t hash = get_full_hash (hash_map, in_pair->key);
+  if (!hash_map->multimap
+      && find_live_pair (hash_map, in_pair->key, hash) != NULL)
+    {
+      return FAIL;
+    }
+  *p_hash = hash;
+  return SUCCESS;
+}
+
+/**
+ * evicts the least recently used pairs while an LRU hash map is over its
+ * budget, keeping at least one pair
+ * @param hash_map
+ */
+void lru_evict (hashmap *hash_map)
+{
+  while (hash_map->size > ONE
+         && ((hash_map->max_entries > ZERO
+              && hash_map->size > hash_map->max_entries)
+             || (hash_map->max_bytes > ZERO
+                 && hash_map->lru->bytes > hash_map->max_bytes)))
+    {
+      pair *tail = hash_map->lru->tail;
+      if (erase_pair (hash_map, tail->key, tail->hash, tail) == FAIL)
+        {
+          return;
+        }
+      if (hash_map->counters != NULL)
+        {
+          hash_map->counters->evictions++;
+        }
+    }
+}
+
+/**
+ * inserts a pair whose hash is cached, growing the buckets if needed
+ * @param hash_map
+ * @param new_pair dynamically allocated pair, the hash map takes ownership
+ * of it upon success
+ * @return 1 upon success 0 upon failure
+ */
+int insert_hashed (hashmap *hash_map, pair *new_pair)
+{
+  if ((double) (hash_map->size + ONE) / hash_map->capacity
+      > HASH_MAP_MAX_LOAD_FACTOR
+      && resize_hashmap (hash_map, hash_map->capacity
+                                   * HASH_MAP_GROWTH_FACTOR) == FAIL)
+    {
+      return FAIL;
+    }
+  if (hash_map->cuckoo != NULL)
+    {
+      // growing does not help once the table is sparse, then too many keys
+      // share their full hash
+      while (cuckoo_insert (hash_map->cuckoo, new_pair) == FAIL)
+        {
+          if (hashmap_get_load_factor (hash_map) < HASH_MAP_MIN_LOAD_FACTOR
+              || resize_hashmap (hash_map, hash_map->capacity
+                                           * HASH_MAP_GROWTH_FACTOR) == FAIL)
+            {
+              return FAIL;
+            }
+        }
+    }
+  else if (hash_map->compact != NULL)
+    {
+      // the entries erased since the last rebuild take room until the
+      // entries are packed (at the same capacity)
+      if (compact_insert (hash_map->compact, new_pair) == FAIL
+          && (compact_rehash (hash_map->compact, hash_map->capacity,
+                              compact_entry_cap (hash_map->capacity)) == FAIL
+              || compact_insert (hash_map->compact, new_pair) == FAIL))
+        {
+          return FAIL;
+        }
+    }
+  else
+    {
+      bucket *current = &hash_map->buckets[new_pair->hash
+                                           & (hash_map->capacity - ONE)];
+      if (bucket_push (&hash_map->allocator, current, new_pair) == FAIL)
+        {
+          return FAIL;
+        }
+      if (hash_map->multimap)
+        {
+          group_pushed_pair (hash_map, current);
+        }
+      sort_pushed_pair (hash_map, current);
+    }
+  hash_map->size++;
+  if (hash_map->filter != NULL)
+    {
+      bloom_add (hash_map->filter, new_pair->hash);
+    }
+  link_pair (hash_map, new_pair);
+  if (hash_map->lru != NULL)
+    {
+      lru_evict (hash_map);
+    }
+  return SUCCESS;
+}
+
+/**
+ * @param hash_map
+ * @return the allocator of the pairs the hash map makes, NULL while it is the
+ * default one (whose memory is malloc's), so pairs made by pair_alloc are
+ * taken as they are
+ */
+const hashmap_allocator *pair_allocator (const hashmap *hash_map)
+{
+  return hash_map->allocator.allocate == allocator_default ().allocate
+         ? NULL : &hash_map->allocator;
+}
+
+/**
+ * finds the copy of type held by the hash map, with the prefix of its pairs,
+ * and its allocator, adding one if there is none, so the pairs of one kind
+ * share a single type
+ * @param hash_map
+ * @param type
+ * @param timer 1 for the type of pairs inserted with a TTL
+ * @return the hash map's copy of type, NULL upon failure
+ */
+const pair_type *intern_type (hashmap *hash_map, const pair_type *type,
+                              int timer)
+{
+  pair_type wanted = *type;
+  wanted.prefix = lru_prefix (hash_map)
+                  + (timer ? sizeof (timer_entry) : ZERO);
+  wanted.allocator = pair_allocator (hash_map);
+  // the pairs of a map are mostly of a single kind, searched from the last
+  for (size_t i = hash_map->type_count; i > ZERO; i--)
+    {
+      if (pair_type_equal (hash_map->types[i - ONE], &wanted))
+        {
+          return hash_map->types[i - ONE];
+        }
+    }
+  size_t count = hash_map->type_count;
+  pair_type **types = (pair_type **) allocate
+      (&hash_map->allocator, (count + ONE) * sizeof (pair_type *));
+  pair_type *copy = (pair_type *) allocate (&hash_map->allocator,
+                                            sizeof (pair_type));
+  if (types == NULL || copy == NULL)
+    {
+      deallocate (&hash_map->allocator, types,
+                  (count + ONE) * sizeof (pair_type *));
+      deallocate (&hash_map->allocator, copy, sizeof (pair_type));
+      return NULL;
+    }
+  *copy = wanted;
+  if (count > ZERO)
+    {
+      memcpy (types, hash_map->types, count * sizeof (pair_type *));
+    }
+  types[count] = copy;
+  deallocate (&hash_map->allocator, hash_map->types,
+              count * sizeof (pair_type *));
+  hash_map->types = types;
+  hash_map->type_count = count + ONE;
+  return copy;
+}
+
+/**
+ * copies a pair for the hash map, sharing the hash map's copy of its type
+ * @param hash_map
+ * @param in_pair
+ * @param timer 1 to make room for a TTL
+ * @return dynamically allocated pair, NULL upon failure or if in_pair can
+ * not be copied (see pair_copy)
+ */
+pair *copy_for_map (hashmap *hash_map, const pair *in_pair, int timer)
+{
+  if (!pair_copyable (in_pair))
+    {
+      return NULL;
+    }
+  const pair_type *type = intern_type (hash_map, in_pair->type, timer);
+  return type != NULL ? pair_alloc_type (in_pair->key, pair_value (in_pair),
+                                        type)
+                      : NULL;
+}
+
+/**
+ * inserts a pair given to the hash map, without copying its key and value.
+ * A pair without the prefix (see lru_prefix) or the allocator of the hash
+ * map's pairs is moved to one which has them.
+ * @param hash_map
+ * @param in_pair dynamically allocated pair
+ * @param hash the full hash of the pair's key
+ * @return the inserted pair (in_pair or the one it was moved to, then in_pair
+ * is freed), NULL upon failure (then in_pair is left as it was)
+ */
+pair *insert_given (hashmap *hash_map, pair *in_pair, size_t hash)
+{
+  pair *given = in_pair;
+  if (in_pair->type->prefix != lru_prefix (hash_map)
+      || in_pair->type->allocator != pair_allocator (hash_map))
+    {
+      const pair_type *type = intern_type (hash_map, in_pair->type, ZERO);
+      given = type != NULL ? pair_move (in_pair, type) : NULL;
+      if (given == NULL)
+        {
+          return NULL;
+        }
+    }
+  given->hash = hash;
+  if (insert_hashed (hash_map, given) == FAIL)
+    {
+      if (given != in_pair)
+        {
+          pair_release ((void **) &given);
+        }
+      return NULL;
+    }
+  if (given != in_pair)
+    {
+      pair_release ((void **) &in_pair);
+    }
+  return given;
+}
+
+/**
+ * Inserts a new in_pair to the hash map.
+ * The function inserts *new*, *copied*, *dynamically allocated* in_pair,
+ * NOT the in_pair it receives as a parameter.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param in_pair a in_pair the hash map would contain.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int hashmap_insert (hashmap *hash_map, const pair *in_pair)
+{
+  size_t hash;
+  int good_inputs = check_hashmap_insert_inputs (hash_map, in_pair, &hash);
+  if (good_inputs == FAIL)
+    {
+      return FAIL;
+    }
+  pair *new_pair = copy_for_map (hash_map, in_pair, ZERO);
+  if (new_pair == NULL)
+    {
+      return FAIL;
+    }
+  new_pair->hash = hash;
+  if (insert_hashed (hash_map, new_pair) == FAIL)
+    {
+      pair_free ((void **) &new_pair);
+      return FAIL;
+    }
+  return SUCCESS;
+}
+
+/**
+ * Inserts in_pair itself to the hash map, without copying it or its key and
+ * value. Upon success the hash map owns in_pair and frees it when it is
+ * erased, upon failure the caller still owns it.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param in_pair dynamically allocated pair, usually one which adopted or
+ * borrowed its key and value (see pair_alloc).
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int hashmap_insert_owned (hashmap *hash_map, pair *in_pair)
+{
+  size_t hash;
+  if (check_hashmap_insert_inputs (hash_map, in_pair, &hash) == FAIL)
+    {
+      return FAIL;
+    }
+  return insert_given (hash_map, in_pair, hash) != NULL;
+}
+
+/**
+ * Inserts a copy of in_pair to the hash map (like hashmap_insert), which
+ * expires ttl time units (see hashmap_config.clock) from now. An expired
+ * pair is treated as missing by the lookups (and reclaimed by those that may
+ * change the hash map), and reclaimed by hashmap_expire_step.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param in_pair a in_pair the hash map would contain.
+ * @param ttl the time to live of the pair.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int hashmap_insert_ttl (hashmap *hash_map, const pair *in_pair,
+                        unsigned long long ttl)
+{
+  size_t hash;
+  if (check_hashmap_insert_inputs (hash_map, in_pair, &hash) == FAIL)
+    {
+      return FAIL;
+    }
+  unsigned long long now = hash_map->clock ();
+  if (hash_map->wheel == NULL)
+    {
+      hash_map->wheel = timer_wheel_alloc (now);
+      if (hash_map->wheel == NULL)
+        {
+          return FAIL;
+        }
+    }
+  pair *new_pair = copy_for_map (hash_map, in_pair, ONE);
+  if (new_pair == NULL)
+    {
+      return FAIL;
+    }
+  new_pair->hash = hash;
+  // a TTL running past the end of time never expires, 0 stands for no TTL
+  timer_of (hash_map, new_pair)->expires = ttl > ULLONG_MAX - now ? ULLONG_MAX
+                                           : now + ttl > ZERO ? now + ttl
+                                                              : ONE;
+  if (insert_hashed (hash_map, new_pair) == FAIL)
+    {
+      pair_free ((void **) &new_pair);
+      return FAIL;
+    }
+  return SUCCESS;
+}
+
+/**
+ * Erases up to budget pairs which expired by now, advancing a timer wheel
+ * instead of scanning the buckets, so it can be called often with a small
+ * budget.
+ * @param hash_map a hash map.
+ * @param now the current time (see hashmap_config.clock).
+ * @param budget the maximal number of pairs to erase.
+ * @return the number of erased pairs.
+ */
+size_t hashmap_expire_step (hashmap *hash_map, unsigned long long now,
+                            size_t budget)
+{
+  if (hash_map == NULL || hash_map->wheel == NULL)
+    {
+      return ZERO;
+    }
+  size_t erased = ZERO;
+  while (erased < budget)
+    {
+      timer_entry *due = timer_wheel_next_expired (hash_map->wheel, now);
+      if (due == NULL)
+        {
+          break;
+        }
+      pair *entry = timer_pair (hash_map, due);
+      if (erase_pair (hash_map, entry->key, entry->hash, entry) == FAIL)
+        {
+          // keep the pair rather than retrying it forever
+          timer_wheel_remove (hash_map->wheel, due);
+          due->expires = ZERO;
+          continue;
+        }
+      erased++;
+    }
+  return erased;
+}
+
+/**
+ * @param entry
+ * @return the slot of the value of the pair, NULL if it holds a key only
+ * (whose slot would let the key change under its cached hash)
+ */
+valueT *value_slot (pair *entry)
+{
+  return entry->type->key_only ? NULL : &entry->value;
+}
+
+/**
+ * The function returns the value associated with the given key.
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @return the value associated with key if exists, NULL otherwise (the value
+ * itself, not a copy of it).
+ */
+valueT hashmap_at (const hashmap *hash_map, const_keyT key)
+{
+  if (hash_map == NULL || key == NULL)
+    {
+      return NULL;
+    }
+  pair *found = find_pair (hash_map, key, get_full_hash (hash_map, key));
+  // an expired pair is left for the next change of the hash map to reclaim
+  if (found == NULL || pair_expired (hash_map, found))
+    {
+      return NULL;
+    }
+  lru_touch (hash_map, found);
+  return pair_value (found);
+}
+
+/**
+ * The function returns a pointer to the value slot of the pair associated
+ * with key, through which the value can be read, changed in place or
+ * replaced (then freeing the old value is up to the caller).
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @return pointer to the value slot if key exists, NULL otherwise, also for
+ * a key-only pair (see pair_type), whose key must not change under its
+ * cached hash. The slot stays valid until key is erased, inserts and resizes
+ * do not move it. The slot of a value stored inline (see pair_alloc_inline)
+ * may only be used to change the value in place, never replaced.
+ */
+valueT *hashmap_at_mut (hashmap *hash_map, const_keyT key)
+{
+  if (hash_map == NULL || key == NULL)
+    {
+      return NULL;
+    }
+  pair *found = find_live_pair (hash_map, key,
+                                get_full_hash (hash_map, key));
+  if (found == NULL)
+    {
+      return NULL;
+    }
+  lru_touch (hash_map, found);
+  return value_slot (found);
+}
+
+/**
+ * The function returns a pointer to the value slot of the pair associated
+ * with key, inserting the pair made by default_factory if key is missing.
+ * The key is hashed and searched only once.
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @param default_factory makes a dynamically allocated pair for key (the
+ * hash map takes ownership of it, see hashmap_insert_owned). A pair of
+ * another key, or a key-only pair, is freed and not inserted.
+ * @return pointer to the value slot (see hashmap_at_mut), NULL upon failure.
+ */
+valueT *hashmap_get_or_insert_default (hashmap *hash_map, const_keyT key,
+                                       pair_factory default_factory)
+{
+  if (hash_map == NULL || key == NULL || default_factory == NULL)
+    {
+      return NULL;
+    }
+  size_t hash = get_full_hash (hash_map, key);
+  pair *found = find_live_pair (hash_map, key, hash);
+  if (found != NULL)
+    {
+      lru_touch (hash_map, found);
+      return value_slot (found);
+    }
+  pair *new_pair = default_factory (key);
+  if (new_pair == NULL)
+    {
+      return NULL;
+    }
+  // the pair is filed under the hash of key, so it must hold key itself
+  pair *inserted = NULL;
+  if (new_pair->key == NULL || new_pair->type->key_only
+      || new_pair->value == NULL
+      || new_pair->type->key_cmp (new_pair->key, key) == FAIL
+      || (inserted = insert_given (hash_map, new_pair, hash)) == NULL)
+    {
+      pair_free ((void **) &new_pair);
+      return NULL;
+    }
+  return value_slot (inserted);
+}
+
+/**
+ * The function erases the pair associated with key. In a multimap, it erases
+ * the first inserted pair of key.
+ * @param hash_map a hash map.
+ * @param key a key of the pair to be erased.
+ * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in
+ * map, considered fail).
+ */
+int hashmap_erase (hashmap *hash_map, const_keyT key)
+{
+  if (hash_map == NULL || key == NULL)
+    {
+      return FAIL;
+    }
+  return erase_pair (hash_map, key, get_full_hash (hash_map, key), NULL);
+}
+
+/**
+ * calls visit on each live pair of key, in insertion order
+ * @param hash_map
+ * @param key
+ * @param visit called with each pair's key, value and ctx, may be NULL to
+ * count only
+ * @param ctx
+ * @return the number of live pairs of key
+ */
+size_t visit_key_range (const hashmap *hash_map, const_keyT key,
+                        hashmap_visit_func visit, void *ctx)
+{
+  size_t hash = get_full_hash (hash_map, key);
+  size_t size = ONE;
+  pair **pairs;
+  int location = ZERO;
+  if (hash_map->buckets == NULL)
+    {
+      // the other backends hold a key at most once
+      pair *found = find_pair (hash_map, key, hash);
+      pairs = &found;
+      size = found != NULL;
+    }
+  else
+    {
+      if (hash_map->filter != NULL
+          && bloom_may_contain (hash_map->filter, hash) == FAIL)
+        {
+          return ZERO;
+        }
+      const bucket *current = &hash_map->buckets[hash
+                                                 & (hash_map->capacity - ONE)];
+      location = find_in_bucket (hash_map, current, key, hash);
+      if (location == NEGATIVE)
+        {
+          return ZERO;
+        }
+      size = bucket_size (current);
+      pairs = bucket_pairs (current);
+    }
+  size_t count = ZERO;
+  // the first pair matched already, the pairs of key are adjacent after it
+  for (size_t i = (size_t) location; i < size; i++)
+    {
+      if (i > (size_t) location)
+        {
+          if (pairs[i]->hash != hash)
+            {
+              break;
+            }
+          count_key_cmp (hash_map);
+          if (pairs[i]->type->key_cmp (pairs[i]->key, key) != ONE)
+            {
+              break;
+            }
+        }
+      if (pair_expired (hash_map, pairs[i]))
+        {
+          continue;
+        }
+      if (visit != NULL)
+        {
+          visit (pairs[i]->key, pair_value (pairs[i]), ctx);
+        }
+      count++;
+    }
+  return count;
+}
+
+/**
+ * The function calls visit on every pair associated with key (more than one
+ * in a multimap), in insertion order. The pairs of a key are adjacent in
+ * their bucket, so they are walked contiguously.
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @param visit called with the key, value (which it may change in place) and
+ * ctx of each pair. It must not change the hash map.
+ * @param ctx passed to visit.
+ * @return the number of visited pairs.
+ */
+size_t hashmap_equal_range (const hashmap *hash_map, const_keyT key,
+                            hashmap_visit_func visit, void *ctx)
+{
+  if (hash_map == NULL || key == NULL || visit == NULL)
+    {
+      return ZERO;
+    }
+  return visit_key_range (hash_map, key, visit, ctx);
+}
+
+/**
+ * The function returns the number of pairs associated with key (0 or 1,
+ * unless the hash map is a multimap).
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @return the number of pairs of key.
+ */
+size_t hashmap_count (const hashmap *hash_map, const_keyT key)
+{
+  if (hash_map == NULL || key == NULL)
+    {
+      return ZERO;
+    }
+  return visit_key_range (hash_map, key, NULL, NULL);
+}
+
+/**
+ * This function returns the load factor of the hash map.
+ * @param hash_map a hash map.
+ * @return the hash map's load factor, -1 if the function failed.
+ */
+double hashmap_get_load_factor (const hashmap *hash_map)
+{
+  if (hash_map == NULL)
+    {
+      return NEGATIVE;
+    }
+  return (double) hash_map->size / hash_map->capacity;
+}
+/**
+ * fills the chain stats of a compact table, where the chain of a pair is its
+ * probe sequence: a pair found at the i'th probed slot counts as a chain of
+ * length i
+ * @param table
+ * @param stats
+ */
+void compact_chain_stats (const compact_table *table, hashmap_stats *stats)
+{
+  size_t mask = table->index_size - ONE;
+  size_t probes = ZERO;
+  for (size_t slot = ZERO; slot < table->index_size; slot++)
+    {
+      if (table->index[slot] < ZERO)
+        {
+          continue;
+        }
+      size_t home = table->entries[table->index[slot]].hash & mask;
+      size_t len = ((slot - home) & mask) + ONE;
+      probes += len;
+      stats->used_buckets++;
+      if (len > stats->max_chain)
+        {
+          stats->max_chain = len;
+        }
+      stats->chain_histogram[len < HASH_MAP_STATS_HISTOGRAM ? len :
+                             HASH_MAP_STATS_HISTOGRAM - ONE]++;
+    }
+  if (stats->used_buckets > ZERO)
+    {
+      stats->mean_chain = (double) probes / stats->used_buckets;
+    }
+}
+
+/**
+ * calls visit on every pair of the hash map, in the order of its backend
+ * (insertion order with a compact table)
+ * @param hash_map
+ * @param visit called with each pair and ctx
+ * @param ctx
+ */
+void visit_pairs (const hashmap *hash_map, pair_visit_func visit, void *ctx)
+{
+  if (hash_map->compact != NULL)
+    {
+      // a linear scan of the packed entries, in insertion order
+      const compact_entry *entries = hash_map->compact->entries;
+      for (size_t i = ZERO; i < hash_map->compact->used; i++)
+        {
+          if (entries[i].pair != NULL)
+            {
+              visit (entries[i].pair, ctx);
+            }
+        }
+      return;
+    }
+  size_t buckets = hash_map->cuckoo != NULL
+                   ? hash_map->cuckoo->bucket_count : hash_map->capacity;
+  for (size_t i = ZERO; i < buckets; i++)
+    {
+      size_t size = hash_map->cuckoo != NULL ? CUCKOO_BUCKET_SLOTS
+                    : bucket_size (&hash_map->buckets[i]);
+      pair **pairs = hash_map->cuckoo != NULL
+                     ? hash_map->cuckoo->buckets[i].pairs
+                     : bucket_pairs (&hash_map->buckets[i]);
+      for (size_t j = ZERO; j < size; j++)
+        {
+          if (pairs[j] != NULL)
             {
-              valT_func (((pair *) vector_at(hash_map->buckets[i], j))->value);
-              count++;
+              visit (pairs[j], ctx);
             }
         }
     }
-  return count;
+}
+
+/**
+ * adds the bytes of a pair to a count
+ * @param entry
+ * @param ctx pointer to the size_t count
+ */
+void count_pair_bytes (pair *entry, void *ctx)
+{
+  *(size_t *) ctx += pair_bytes (entry);
+}
+
+/**
+ * This function fills stats with a snapshot of the hash map's bucket
+ * occupancy, chain lengths and runtime counters.
+ * @param hash_map a hash map.
+ * @param stats the stats to be filled.
+ * @return 1 upon success, 0 otherwise.
+ */
+int hashmap_get_stats (const hashmap *hash_map, hashmap_stats *stats)
+{
+  if (hash_map == NULL || stats == NULL)
+    {
+      return FAIL;
+    }
+  memset (stats, ZERO, sizeof (hashmap_stats));
+  stats->size = hash_map->size;
+  stats->capacity = hash_map->capacity;
+  stats->bytes_allocated = sizeof (hashmap) + hash_map->type_count
+                                             * (sizeof (pair_type *)
+                                                + sizeof (pair_type));
+  visit_pairs (hash_map, count_pair_bytes, &stats->bytes_allocated);
+  if (hash_map->counters != NULL)
+    {
+      stats->key_cmp_calls = hash_map->counters->key_cmp_calls;
+      stats->grows = hash_map->counters->grows;
+      stats->shrinks = hash_map->counters->shrinks;
+      stats->resize_seconds = hash_map->counters->resize_seconds;
+      stats->evictions = hash_map->counters->evictions;
+      stats->bytes_allocated += sizeof (hashmap_counters);
+    }
+  if (hash_map->cuckoo != NULL)
+    {
+      stats->bytes_allocated += sizeof (cuckoo_table)
+                                + hash_map->cuckoo->bucket_count
+                                  * sizeof (cuckoo_bucket);
+    }
+  else if (hash_map->compact != NULL)
+    {
+      stats->bytes_allocated += sizeof (compact_table)
+                                + hash_map->capacity * sizeof (int32_t)
+                                + hash_map->compact->entry_cap
+                                  * sizeof (compact_entry);
+    }
+  else
+    {
+      stats->bytes_allocated += hash_map->capacity * sizeof (bucket);
+    }
+  if (hash_map->filter != NULL)
+    {
+      stats->bytes_allocated += bloom_bytes (hash_map->filter);
+    }
+  if (hash_map->lru != NULL)
+    {
+      stats->bytes_allocated += sizeof (hashmap_lru);
+    }
+  if (hash_map->wheel != NULL)
+    {
+      stats->bytes_allocated += sizeof (timer_wheel);
+    }
+  if (hash_map->compact != NULL)
+    {
+      compact_chain_stats (hash_map->compact, stats);
+      return SUCCESS;
+    }
+  size_t buckets = hash_map->cuckoo != NULL
+                   ? hash_map->cuckoo->bucket_count : hash_map->capacity;
+  for (size_t i = ZERO; i < buckets; i++)
+    {
+      if (hash_map->cuckoo != NULL)
+        {
+          size_t len = cuckoo_bucket_size (&hash_map->cuckoo->buckets[i]);
+          stats->used_buckets += len > ZERO;
+          stats->max_chain = len > stats->max_chain ? len : stats->max_chain;
+          stats->chain_histogram[len]++;
+          continue;
+        }
+      const bucket *current = &hash_map->buckets[i];
+      size_t len = bucket_size (current);
+      const bucket_spill *spill = bucket_spilled (current);
+      if (spill != NULL)
+        {
+          stats->bytes_allocated += spill_bytes (spill->capacity);
+        }
+      if (len > ZERO)
+        {
+          stats->used_buckets++;
+        }
+      if (len > stats->max_chain)
+        {
+          stats->max_chain = len;
+        }
+      stats->chain_histogram[len < HASH_MAP_STATS_HISTOGRAM ? len :
+                             HASH_MAP_STATS_HISTOGRAM - ONE]++;
+    }
+  if (stats->used_buckets > ZERO)
+    {
+      stats->mean_chain = (double) hash_map->size / stats->used_buckets;
+    }
+  return SUCCESS;
+}
+
+/**
+ * @struct apply_if_ctx - the funcs and count of hashmap_apply_if
+ */
+typedef struct apply_if_ctx {
+    keyT_func key_func;
+    valueT_func value_func;
+    int count;
+} apply_if_ctx;
+
+/**
+ * applies the value func of hashmap_apply_if to a pair meeting its condition
+ * @param entry
+ * @param ctx pointer to apply_if_ctx
+ */
+void apply_if_pair (pair *entry, void *ctx)
+{
+  apply_if_ctx *apply = (apply_if_ctx *) ctx;
+  if (apply->key_func (entry->key) == ONE)
+    {
+      apply->value_func (pair_value (entry));
+      apply->count++;
+    }
+}
+
+/**
+ * This function receives a hashmap and 2 functions, the first checks a
+ * condition on the keys, and the seconds apply some modification on the
+ * values. The function should apply the modification
+ * only on the values that are associated with keys that meet the condition.
+ *
+ * Example: if the hashmap maps char->int, keyT_func checks if the char is a
+ * capital letter (A-Z), and val_t_func multiples the number by 2,
+ * hashmap_apply_if will resize_hashmap the map:
+ * {('C',2),('#',3),('X',5)}, to: {('C',4),('#',3),('X',10)},
+ * and the return value will be 2.
+ * @param hash_map a hashmap
+ * @param keyT_func a function that checks a condition on keyT and return 1
+ * if true, 0 else
+ * @param valT_func a function that modifies valueT, in-place
+ * @return number of changed values
+ */
+int hashmap_apply_if (const hashmap *hash_map, keyT_func keyT_func,
+                  valueT_func valT_func)
+{
+  if (hash_map == NULL || keyT_func == NULL || valT_func == NULL)
+    {
+      return NEGATIVE;
+    }
+  apply_if_ctx apply = {keyT_func, valT_func, ZERO};
+  visit_pairs (hash_map, apply_if_pair, &apply);
+  return apply.count;
+}
+
+/**
+ * @struct foreach_ctx - the visit func, its ctx and the count of
+ * hashmap_foreach
+ */
+typedef struct foreach_ctx {
+    hashmap_visit_func visit;
+    void *ctx;
+    size_t count;
+} foreach_ctx;
+
+/**
+ * calls the visit func of hashmap_foreach on a pair
+ * @param entry
+ * @param ctx pointer to foreach_ctx
+ */
+void foreach_pair (pair *entry, void *ctx)
+{
+  foreach_ctx *foreach = (foreach_ctx *) ctx;
+  foreach->visit (entry->key, pair_value (entry), foreach->ctx);
+  foreach->count++;
+}
+
+/**
+ * This function calls visit on every pair of the hash map (in insertion
+ * order with config->compact, in no particular order otherwise).
+ * @param hash_map a hashmap
+ * @param visit called with the key, value (which it may change in place) and
+ * ctx of each pair. It must not change the hash map.
+ * @param ctx passed to visit.
+ * @return number of visited pairs
+ */
+size_t hashmap_foreach (const hashmap *hash_map, hashmap_visit_func visit,
+                        void *ctx)
+{
+  if (hash_map == NULL || visit == NULL)
+    {
+      return ZERO;
+    }
+  foreach_ctx foreach = {visit, ctx, ZERO};
+  visit_pairs (hash_map, foreach_pair, &foreach);
+  return foreach.count;
+}
+
+/**
+ * @param hash_map_1, hash_map_2
+ * @return 1 if the hash maps hash keys the same way, so the cached hash of a
+ * pair of one of them is also its hash in the other
+ */
+int same_hashing (const hashmap *hash_map_1, const hashmap *hash_map_2)
+{
+  return hash_map_1->hash_func == hash_map_2->hash_func
+         && hash_map_1->mix_hash == hash_map_2->mix_hash
+         && hash_map_1->keyed_hash == hash_map_2->keyed_hash
+         && (hash_map_1->keyed_hash == NULL
+             || (hash_map_1->seed.k0 == hash_map_2->seed.k0
+                 && hash_map_1->seed.k1 == hash_map_2->seed.k1));
+}
+
+/**
+ * grows the hash map once, so it can take size pairs without resizing
+ * @param hash_map
+ * @param size the number of pairs the hash map should hold
+ * @return 1 upon success 0 upon failure
+ */
+int reserve_hashmap (hashmap *hash_map, size_t size)
+{
+  if (hash_map->max_entries > ZERO && size > hash_map->max_entries)
+    {
+      size = hash_map->max_entries;
+    }
+  size_t capacity = hash_map->capacity;
+  while ((double) size / capacity > HASH_MAP_MAX_LOAD_FACTOR)
+    {
+      capacity *= HASH_MAP_GROWTH_FACTOR;
+    }
+  if (capacity == hash_map->capacity)
+    {
+      return SUCCESS;
+    }
+  return resize_hashmap (hash_map, capacity);
+}
+
+/**
+ * This function grows the hash map once, so it can take size pairs without
+ * resizing (e.g. before inserting the pairs of several hash maps).
+ * @param hash_map
+ * @param size the number of pairs the hash map should hold, capped by
+ * max_entries.
+ * @return 1 upon success, 0 upon failure (then the hash map is unchanged).
+ */
+int hashmap_reserve (hashmap *hash_map, size_t size)
+{
+  if (hash_map == NULL)
+    {
+      return FAIL;
+    }
+  return reserve_hashmap (hash_map, size);
+}
+
+/**
+ * clears the flag of ctx if the pair can not be copied
+ * @param entry
+ * @param ctx pointer to an int flag
+ */
+void copyable_pair (pair *entry, void *ctx)
+{
+  if (!pair_copyable (entry))
+    {
+      *(int *) ctx = ZERO;
+    }
+}
+
+/**
+ * @param hash_map
+ * @return 1 if every pair of the hash map can be copied (see pair_copy)
+ */
+int all_copyable (const hashmap *hash_map)
+{
+  int copyable = ONE;
+  visit_pairs (hash_map, copyable_pair, &copyable);
+  return copyable;
+}
+
+/**
+ * inserts a copy of a pair of another hash map (without its TTL)
+ * @param hash_map
+ * @param entry
+ * @param hash the full hash of the pair's key in hash_map
+ * @return 1 upon success 0 upon failure
+ */
+int insert_copy (hashmap *hash_map, const pair *entry, size_t hash)
+{
+  pair *new_pair = copy_for_map (hash_map, entry, ZERO);
+  if (new_pair == NULL)
+    {
+      return FAIL;
+    }
+  new_pair->hash = hash;
+  if (insert_hashed (hash_map, new_pair) == FAIL)
+    {
+      pair_free ((void **) &new_pair);
+      return FAIL;
+    }
+  return SUCCESS;
+}
+
+/**
+ * @struct bulk_ctx - a merge or an intersection in progress.
+ * @param dst the hash map the pairs are inserted to.
+ * @param src the hash map being visited.
+ * @param other the hash map the keys of src are looked up in (intersection).
+ * @param first the hash map whose pairs are copied (intersection).
+ * @param conflict the conflict func of a merge.
+ * @param failed set once an insertion failed.
+ */
+typedef struct bulk_ctx {
+    hashmap *dst;
+    const hashmap *src;
+    const hashmap *other;
+    const hashmap *first;
+    hashmap_merge_func conflict;
+    int failed;
+} bulk_ctx;
+
+/**
+ * finds the pair of key in the hash map being inserted to by a merge or an
+ * intersection. An expired pair is absent: it is dropped without shrinking
+ * the hash map, which was grown for the whole operation, so its buckets stay
+ * as they are while the operation goes on.
+ * @param hash_map
+ * @param key
+ * @param hash full hash of key
+ * @return the pair holding key, NULL if not found or expired
+ */
+pair *find_bulk_pair (hashmap *hash_map, const_keyT key, size_t hash)
+{
+  pair *found = find_pair (hash_map, key, hash);
+  if (found != NULL && pair_expired (hash_map, found))
+    {
+      remove_pair (hash_map, key, hash, found);
+      return NULL;
+    }
+  return found;
+}
+
+/**
+ * merges a pair of src into dst
+ * @param entry
+ * @param ctx pointer to bulk_ctx
+ */
+void merge_pair (pair *entry, void *ctx)
+{
+  bulk_ctx *merge = (bulk_ctx *) ctx;
+  if (merge->failed || pair_expired (merge->src, entry))
+    {
+      return;
+    }
+  size_t hash = same_hashing (merge->dst, merge->src)
+                ? entry->hash : get_full_hash (merge->dst, entry->key);
+  pair *found = merge->dst->multimap ? NULL
+                : find_bulk_pair (merge->dst, entry->key, hash);
+  if (found != NULL)
+    {
+      if (merge->conflict != NULL)
+        {
+          merge->conflict (pair_value (found), pair_value (entry));
+        }
+      return;
+    }
+  if (insert_copy (merge->dst, entry, hash) == FAIL)
+    {
+      merge->failed = ONE;
+    }
+}
+
+/**
+ * copies the pair of first holding a key of src into dst, if the key is
+ * also in other
+ * @param entry
+ * @param ctx pointer to bulk_ctx
+ */
+void intersect_pair (pair *entry, void *ctx)
+{
+  bulk_ctx *intersect = (bulk_ctx *) ctx;
+  if (intersect->failed || pair_expired (intersect->src, entry))
+    {
+      return;
+    }
+  size_t hash = same_hashing (intersect->src, intersect->other)
+                ? entry->hash : get_full_hash (intersect->other, entry->key);
+  pair *found = find_pair (intersect->other, entry->key, hash);
+  if (found == NULL || pair_expired (intersect->other, found))
+    {
+      return;
+    }
+  const pair *copied = intersect->first == intersect->src ? entry : found;
+  hash = same_hashing (intersect->dst, intersect->first)
+         ? copied->hash : get_full_hash (intersect->dst, copied->key);
+  if (!intersect->dst->multimap
+      && find_bulk_pair (intersect->dst, copied->key, hash) != NULL)
+    {
+      return;
+    }
+  if (insert_copy (intersect->dst, copied, hash) == FAIL)
+    {
+      intersect->failed = ONE;
+    }
+}
+
+/**
+ * This function inserts copies of the pairs of src to dst. dst is grown
+ * once, up front, and the hashes cached in src are reused when both hash
+ * maps hash keys the same way (same funcs, mix_hash and seed).
+ * @param dst the hash map to be merged into.
+ * @param src the hash map to be merged, unchanged. Its pairs must not have
+ * adopted their keys or values (see hashmap_insert_owned), since the copies
+ * can not share them: such a src is rejected before dst is changed.
+ * @param conflict called with the value in dst and the value in src of a
+ * key which is in both (and not in a multimap dst), to merge the latter
+ * into the former in place. NULL to keep the value in dst.
+ * @return 1 upon success, 0 otherwise (then dst may hold part of src).
+ * Expired pairs of src are skipped, and the copies get no TTL.
+ */
+int hashmap_merge (hashmap *dst, const hashmap *src,
+                   hashmap_merge_func conflict)
+{
+  if (dst == NULL || src == NULL || dst == src || !all_copyable (src)
+      || reserve_hashmap (dst, dst->size + src->size) == FAIL)
+    {
+      return FAIL;
+    }
+  bulk_ctx merge = {dst, src, NULL, NULL, conflict, ZERO};
+  visit_pairs (src, merge_pair, &merge);
+  return !merge.failed;
+}
+
+/**
+ * This function inserts to out copies of the pairs of a whose keys are also
+ * in b. The smaller of a and b is visited and its keys are looked up in the
+ * other one, out is grown once, up front, and cached hashes are reused
+ * between hash maps which hash keys the same way.
+ * @param a the hash map whose pairs are copied, which must not have
+ * adopted their keys or values (then out is left unchanged and 0 returned).
+ * @param b the hash map whose keys are kept.
+ * @param out the hash map to be inserted with the intersection, keys which
+ * are in it already are left as they are.
+ * @return 1 upon success, 0 otherwise (then out may hold part of the
+ * intersection). Expired pairs are skipped, and the copies get no TTL.
+ */
+int hashmap_intersect (const hashmap *a, const hashmap *b, hashmap *out)
+{
+  if (a == NULL || b == NULL || out == NULL || out == a || out == b
+      || !all_copyable (a))
+    {
+      return FAIL;
+    }
+  const hashmap *smaller = a->size <= b->size ? a : b;
+  const hashmap *larger = smaller == a ? b : a;
+  if (reserve_hashmap (out, out->size + smaller->size) == FAIL)
+    {
+      return FAIL;
+    }
+  bulk_ctx intersect = {out, smaller, larger, a, NULL, ZERO};
+  visit_pairs (smaller, intersect_pair, &intersect);
+  return !intersect.failed;
+}
+
+/**
+ * gives every bucket which will hold more than one pair a spill array with
+ * room for exactly all of them
+ * @param allocator the allocator of the hash map
+ * @param buckets
+ * @param counts the number of pairs each bucket will hold
+ * @param capacity number of buckets
+ * @return 1 upon success 0 upon failure
+ */
+int reserve_buckets (const hashmap_allocator *allocator, bucket *buckets,
+                     const size_t *counts, size_t capacity)
+{
+  for (size_t i = ZERO; i < capacity; i++)
+    {
+      if (counts[i] > ONE
+          && spill_bucket (allocator, &buckets[i], counts[i]) == FAIL)
+        {
+          return FAIL;
+        }
+    }
+  return SUCCESS;
+}
+
+/**
+ * This function builds a hash map from parallel arrays of keys and values,
+ * in one pass: the buckets are sized for n up front, all the keys are
+ * hashed and counted per bucket, and the pairs are scattered into buckets
+ * whose room is reserved, so nothing is resized or searched while building.
+ * @param func a function which "hashes" keys.
+ * @param keys n keys, which must be distinct (it is not checked).
+ * @param values n values, values[i] is the value of keys[i].
+ * @param n the number of pairs.
+ * @param type a pair whose funcs (and inline sizes) the pairs are made with
+ * (see pair_alloc and pair_alloc_inline).
+ * @return pointer to dynamically allocated hashmap, NULL upon failure.
+ */
+hashmap *hashmap_from_arrays (hash_func func, const const_keyT *keys,
+                              const const_valueT *values, size_t n,
+                              const pair *type)
+{
+  if (func == NULL || type == NULL
+      || (n > ZERO && (keys == NULL || values == NULL)))
+    {
+      return NULL;
+    }
+  size_t capacity = HASH_MAP_INITIAL_CAP;
+  while ((double) n / capacity > HASH_MAP_MAX_LOAD_FACTOR)
+    {
+      capacity *= HASH_MAP_GROWTH_FACTOR;
+    }
+  hashmap *hash_map = hashmap_alloc (func);
+  pair **pairs = (pair **) malloc ((n + ONE) * sizeof (pair *));
+  bucket *buckets = hash_map == NULL ? NULL : (bucket *) allocate
+      (&hash_map->allocator, capacity * sizeof (bucket));
+  size_t *counts = (size_t *) calloc (capacity, sizeof (size_t));
+  const pair_type *kind = hash_map == NULL ? NULL
+                                           : intern_type (hash_map, type->type,
+                                                          ZERO);
+  size_t made = ZERO;
+  for (; kind != NULL && pairs != NULL && counts != NULL && made < n; made++)
+    {
+      pairs[made] = keys[made] != NULL && values[made] != NULL
+                    ? pair_alloc_type (keys[made], values[made], kind) : NULL;
+      if (pairs[made] == NULL)
+        {
+          break;
+        }
+      pairs[made]->hash = get_full_hash (hash_map, pairs[made]->key);
+      counts[pairs[made]->hash & (capacity - ONE)]++;
+    }
+  if (made < n || buckets == NULL || counts == NULL
+      || reserve_buckets (&hash_map->allocator, buckets, counts, capacity)
+         == FAIL)
+    {
+      while (made > ZERO)
+        {
+          pair_free ((void **) &pairs[--made]);
+        }
+      if (buckets != NULL)
+        {
+          release_buckets (hash_map, buckets, capacity);
+        }
+      free (pairs);
+      free (counts);
+      hashmap_free (&hash_map);
+      return NULL;
+    }
+  for (size_t i = ZERO; i < n; i++)
+    {
+      // cannot fail, the room is reserved
+      bucket_push (&hash_map->allocator,
+                   &buckets[pairs[i]->hash & (capacity - ONE)], pairs[i]);
+    }
+  for (size_t i = ZERO; i < capacity; i++)
+    {
+      if (counts[i] >= HASH_MAP_TREEIFY_THRESHOLD)
+        {
+          sort_bucket (hash_map, bucket_pairs (&buckets[i]), counts[i]);
+        }
+    }
+  free (pairs);
+  free (counts);
+  deallocate (&hash_map->allocator, hash_map->buckets,
+              hash_map->capacity * sizeof (bucket));
+  hash_map->buckets = buckets;
+  hash_map->capacity = capacity;
+  hash_map->size = n;
+  return hash_map;
 }
@@ -2,13 +2,19 @@
 #define HASHMAP_H_
 
 #include <stdlib.h>
+#include <stdint.h>
 #include "vector.h"
 #include "pair.h"
+#include "bloom.h"
+#include "cuckoo.h"
+#include "compact.h"
+#include "timer_wheel.h"
+#include "allocator.h"
 
 /**
  * @def HASH_MAP_INITIAL_CAP
  * The initial capacity of the hash map.
- * It means, the initial number of <b> vectors </b> the hash map has.
+ * It means, the initial number of <b> buckets </b> the hash map has.
  */
 #define HASH_MAP_INITIAL_CAP 16UL
 
@@ -41,6 +47,29 @@
  */
 #define HASH_MAP_MAX_LOAD_FACTOR 0.75
 
+/**
+ * @def HASH_MAP_SPILL_INITIAL_CAP
+ * The number of pairs a bucket_spill array has room for when a bucket
+ * spills, on its first collision.
+ */
+#define HASH_MAP_SPILL_INITIAL_CAP 2UL
+
+/**
+ * @def HASH_MAP_TREEIFY_THRESHOLD
+ * The bucket length from which a bucket is kept sorted by the cached hashes
+ * of its keys, so lookups in it binary search instead of scanning.
+ * Shorter buckets are scanned linearly.
+ */
+#define HASH_MAP_TREEIFY_THRESHOLD 8UL
+
+/**
+ * @def HASH_MAP_STATS_HISTOGRAM
+ * The number of bins in the chain length histogram of hashmap_stats.
+ * Bin i counts the buckets holding i pairs, the last bin counts all the
+ * buckets holding HASH_MAP_STATS_HISTOGRAM - 1 pairs or more.
+ */
+#define HASH_MAP_STATS_HISTOGRAM 8UL
+
 /**
  * @typedef hash_func
  * This type of function receives a keyT and returns
@@ -52,6 +81,23 @@
 typedef size_t (*hash_func) (const_keyT);
 
 
+/**
+ * @struct hashmap_seed
+ * A 128-bit secret key for keyed hash funcs.
+ */
+typedef struct hashmap_seed {
+    unsigned long long k0;
+    unsigned long long k1;
+} hashmap_seed;
+
+/**
+ * @typedef keyed_hash_func
+ * Like hash_func, but the result also depends on a secret seed, so an
+ * attacker who does not know the seed cannot craft colliding keys.
+ * Example: size_t ind = keyed_hash_func('Joe', &seed) & (capacity - 1);
+ */
+typedef size_t (*keyed_hash_func) (const_keyT, const hashmap_seed *);
+
 /**
  * @typedef keyT_func
  * A function that receives a const_keyT, and returns 1 if it fulfills some condition, and 0 else
@@ -64,18 +110,274 @@ typedef int (*keyT_func) (const_keyT);
  */
 typedef void (*valueT_func) (valueT);
 
+/**
+ * @typedef pair_factory
+ * A function that receives a key, and returns a new dynamically allocated
+ * pair holding it with some default value.
+ */
+typedef pair *(*pair_factory) (const_keyT);
+
+/**
+ * @typedef pair_size_func
+ * A function that returns the number of bytes a pair (with its key and
+ * value) costs, for byte budgets.
+ */
+typedef size_t (*pair_size_func) (const pair *);
+
+/**
+ * @typedef hashmap_clock
+ * A function that returns the current time, in the units of the TTLs.
+ */
+typedef unsigned long long (*hashmap_clock) (void);
+
+/**
+ * @typedef hashmap_visit_func
+ * A function that is called with the key and value of a pair (the value may
+ * be changed in place) and a context pointer of the caller.
+ */
+typedef void (*hashmap_visit_func) (const_keyT, valueT, void *);
+
+/**
+ * @typedef pair_visit_func
+ * A function that is called with a pair of a container and a context pointer
+ * of the caller.
+ */
+typedef void (*pair_visit_func) (pair *, void *);
+
+/**
+ * @typedef hashmap_merge_func
+ * A function that merges the second value into the first one, in-place.
+ */
+typedef void (*hashmap_merge_func) (valueT, const_valueT);
+
+/**
+ * @struct hashmap_counters
+ * Runtime counters the hash map updates as it is used, if
+ * hashmap_config.counters is set.
+ * @param key_cmp_calls number of key_cmp calls made by lookups.
+ * @param grows, shrinks number of times the buckets were resized.
+ * @param resize_seconds wall-clock time spent resizing the buckets, by a
+ * monotonic clock.
+ * @param evictions number of pairs evicted by an LRU hash map.
+ */
+typedef struct hashmap_counters {
+    size_t key_cmp_calls;
+    size_t grows;
+    size_t shrinks;
+    double resize_seconds;
+    size_t evictions;
+} hashmap_counters;
+
+/**
+ * @struct lru_links
+ * The links of a pair in the recency list of an LRU hash map, stored right
+ * before the pair (in its prefix, see pair_type).
+ * @param prev, next the more and the less recently used pairs, NULL at the
+ * ends of the list.
+ */
+typedef struct lru_links {
+    pair *prev;
+    pair *next;
+} lru_links;
+
+/**
+ * @struct hashmap_lru
+ * Recency list of an LRU hash map, linked through the lru_links of the
+ * pairs.
+ * @param head the most recently used pair.
+ * @param tail the least recently used pair, evicted first.
+ * @param bytes the total entry_size of the pairs (with a byte budget).
+ */
+typedef struct hashmap_lru {
+    pair *head;
+    pair *tail;
+    size_t bytes;
+} hashmap_lru;
+
+/**
+ * @struct hashmap_stats
+ * A snapshot of the hash map's shape, returned by hashmap_get_stats.
+ * @param size, capacity the size and capacity of the hash map.
+ * @param used_buckets number of buckets holding at least one pair.
+ * @param max_chain the length of the longest bucket.
+ * @param mean_chain mean length of the used buckets.
+ * @param chain_histogram number of buckets by length
+ * (see HASH_MAP_STATS_HISTOGRAM).
+ * @param key_cmp_calls, grows, shrinks, resize_seconds, evictions see
+ * hashmap_counters, 0 if the hash map has no counters.
+ * @param bytes_allocated bytes allocated by the hash map itself (buckets,
+ * spill arrays and pairs), not including keys and values.
+ */
+typedef struct hashmap_stats {
+    size_t size;
+    size_t capacity;
+    size_t used_buckets;
+    size_t max_chain;
+    double mean_chain;
+    size_t chain_histogram[HASH_MAP_STATS_HISTOGRAM];
+    size_t key_cmp_calls;
+    size_t grows;
+    size_t shrinks;
+    double resize_seconds;
+    size_t evictions;
+    size_t bytes_allocated;
+} hashmap_stats;
+
+/**
+ * @struct bucket_spill
+ * The pairs of a bucket which collided, in one allocation sized to them: it
+ * starts with room for HASH_MAP_SPILL_INITIAL_CAP pairs, doubles when full
+ * and halves when three quarters empty.
+ * @param size the number of pairs.
+ * @param capacity the number of pairs there is room for.
+ * @param pairs the pairs.
+ */
+typedef struct bucket_spill {
+    uint32_t size;
+    uint32_t capacity;
+    pair *pairs[];
+} bucket_spill;
+
+/**
+ * @struct bucket
+ * A bucket of the hash map, a single word: a bucket holding one pair points
+ * to it, and on a collision all of its pairs move to a bucket_spill array.
+ * Use bucket_size and bucket_pairs to read it.
+ * @param slot NULL for an empty bucket, the pair of a bucket holding one,
+ * or the bucket_spill array with its lowest bit set.
+ */
+typedef struct bucket {
+    void *slot;
+} bucket;
+
+/**
+ * @param current a bucket.
+ * @return the number of pairs in the bucket.
+ */
+size_t bucket_size (const bucket *current);
+
+/**
+ * @param current a bucket.
+ * @return the array of the bucket's pairs (the inline one or spilled).
+ */
+pair **bucket_pairs (const bucket *current);
+
+/**
+ * @struct hashmap_config
+ * Optional behaviours of a hash map, chosen when it is allocated.
+ * A zeroed config gives the default hash map.
+ * @param mix_hash 1 to pass the output of hash_func through a finalizer
+ * before it is masked into a bucket index, so hash funcs whose outputs differ
+ * only in their high bits (identity hashes of aligned pointers, IDs that are
+ * multiples of a power of 2) still spread over all the buckets.
+ * @param keyed_hash if not NULL, keys are hashed with keyed_hash and the
+ * map's seed instead of with hash_func (which may then be NULL). Use it for
+ * maps keyed on untrusted input.
+ * @param seed the seed of keyed_hash, NULL to draw a random seed per map.
+ * @param bloom_filter 1 to keep a Bloom filter of the keys' hashes, which
+ * answers most lookups of missing keys without walking a bucket. Use it for
+ * maps that are mostly queried for keys they do not hold. Ignored with
+ * cuckoo and compact.
+ * @param cuckoo 1 to store the pairs in a bucketized cuckoo table (two
+ * candidate buckets of CUCKOO_BUCKET_SLOTS pairs, both derived from the full
+ * hash) instead of in chains, so a lookup reads at most two cache lines
+ * whatever the collisions are. Needs a hash func whose full hashes rarely
+ * collide: an insertion fails if no room is found even after growing.
+ * @param compact 1 to store the pairs like a compact dict: appended to a
+ * dense array in insertion order, found through an index of int32 offsets
+ * (see compact.h). hashmap_apply_if then scans the packed array in insertion
+ * order, and resizing rebuilds the small index only. Ignored with cuckoo.
+ * @param max_entries, max_bytes if either is not 0, the hash map is an LRU
+ * cache: lookups (hashmap_at, hashmap_at_mut, hashmap_get_or_insert_default)
+ * make a pair the most recently used, and an insertion which takes the map
+ * over max_entries pairs, or over max_bytes bytes, evicts (erases) the least
+ * recently used pairs, in O(1) each. The new pair itself is never evicted.
+ * @param entry_size the size of a pair for max_bytes, must give the same
+ * size for as long as the pair is stored. Required if max_bytes is set.
+ * @param clock the time source of TTLs (see hashmap_insert_ttl), NULL for
+ * time(NULL), in seconds.
+ * @param multimap 1 to allow several pairs with equal keys: insertions never
+ * fail on an existing key, the pairs of a key are kept adjacent in their
+ * bucket (in insertion order), and hashmap_equal_range and hashmap_count walk
+ * them. Lookups return and hashmap_erase erases the first inserted pair of a
+ * key. Cuckoo and compact are ignored with it.
+ * @param allocator allocates the map, its bucket array (or the tables of
+ * the cuckoo and compact backends), the spill arrays of its buckets, its
+ * Bloom filter, its bookkeeping and the pairs it makes or takes (see
+ * hashmap_insert_owned), NULL for calloc and free (see allocator.h). Use allocator_huge_pages for
+ * maps whose bucket array spans megabytes. It is copied into the map.
+ * @param counters 1 to keep runtime counters (see hashmap_counters). Off by
+ * default: with it, lookups write to the map, so even read-only lookups
+ * must not run concurrently, and resizes read the clock.
+ */
+typedef struct hashmap_config {
+    int mix_hash;
+    keyed_hash_func keyed_hash;
+    const hashmap_seed *seed;
+    int bloom_filter;
+    int cuckoo;
+    int compact;
+    size_t max_entries;
+    size_t max_bytes;
+    pair_size_func entry_size;
+    hashmap_clock clock;
+    int multimap;
+    const hashmap_allocator *allocator;
+    int counters;
+} hashmap_config;
+
 /**
  * @struct hashmap
- * @param buckets dynamic array of vectors which stores the values.
+ * @param buckets dynamic array of buckets which stores the values, NULL
+ * with a cuckoo or a compact table.
  * @param size the number of elements (pairs) stored in the hash map.
- * @param capacity the number of buckets in the hash map.
+ * @param capacity the number of buckets in the hash map (of slots with a
+ * cuckoo table, of index slots with a compact table).
  * @param hash_func a function which "hashes" keys.
+ * @param counters runtime counters, see hashmap_counters, NULL if
+ * config->counters was not set.
+ * @param mix_hash, keyed_hash, seed see hashmap_config.
+ * @param filter Bloom filter of the hashes of the keys (it may also hold
+ * hashes of erased keys until it is rebuilt on the next resize), NULL if
+ * config->bloom_filter was not set.
+ * @param cuckoo the cuckoo table storing the pairs if config->cuckoo was
+ * set, NULL otherwise.
+ * @param compact the compact table storing the pairs if config->compact was
+ * set, NULL otherwise.
+ * @param lru recency list of an LRU hash map, NULL if it is not one.
+ * @param max_entries, max_bytes, entry_size, clock, multimap see
+ * hashmap_config.
+ * @param wheel timer wheel of the timer entries of the pairs inserted with a
+ * TTL, NULL before the first one.
+ * @param allocator the allocator of the map, its buckets and its pairs.
+ * @param types the pair types of the pairs the hash map made (see
+ * pair_alloc_type), held once each and shared by the pairs. Their prefix
+ * holds the lru_links of the pairs of an LRU hash map, preceded by a
+ * timer_entry for the pairs inserted with a TTL.
+ * @param type_count the number of types.
  */
 typedef struct hashmap {
-    vector **buckets;
+    bucket *buckets;
     size_t size;
     size_t capacity; // num of buckets
     hash_func hash_func;
+    hashmap_counters *counters;
+    int mix_hash;
+    keyed_hash_func keyed_hash;
+    hashmap_seed seed;
+    bloom *filter;
+    cuckoo_table *cuckoo;
+    compact_table *compact;
+    hashmap_lru *lru;
+    size_t max_entries;
+    size_t max_bytes;
+    pair_size_func entry_size;
+    hashmap_clock clock;
+    timer_wheel *wheel;
+    int multimap;
+    hashmap_allocator allocator;
+    pair_type **types;
+    size_t type_count;
 } hashmap;
 
 /**
@@ -86,12 +388,46 @@ typedef struct hashmap {
  */
 hashmap *hashmap_alloc (hash_func func);
 
+/**
+ * Allocates dynamically new hash map element with optional behaviours.
+ * @param func a function which "hashes" keys, may be NULL if
+ * config->keyed_hash is set.
+ * @param config the behaviours of the hash map, NULL for the defaults.
+ * @return pointer to dynamically allocated hashmap.
+ * @if_fail return NULL.
+ */
+hashmap *hashmap_alloc_config (hash_func func, const hashmap_config *config);
+
+/**
+ * This function builds a hash map from parallel arrays of keys and values,
+ * in one pass: the buckets are sized for n up front, all the keys are
+ * hashed and counted per bucket, and the pairs are scattered into buckets
+ * whose room is reserved, so nothing is resized or searched while building.
+ * @param func a function which "hashes" keys.
+ * @param keys n keys, which must be distinct (it is not checked).
+ * @param values n values, values[i] is the value of keys[i].
+ * @param n the number of pairs.
+ * @param type a pair whose funcs (and inline sizes) the pairs are made with
+ * (see pair_alloc and pair_alloc_inline).
+ * @return pointer to dynamically allocated hashmap, NULL upon failure.
+ */
+hashmap *hashmap_from_arrays (hash_func func, const const_keyT *keys,
+                              const const_valueT *values, size_t n,
+                              const pair *type);
+
 /**
  * Frees a hash map and the elements the hash map itself allocated.
  * @param p_hash_map pointer to dynamically allocated pointer to hash_map.
  */
 void hashmap_free (hashmap **p_hash_map);
 
+/**
+ * Erases all the elements of a hash map, keeping its capacity so the map can
+ * be refilled without resizing.
+ * @param hash_map the hash map to be cleared.
+ */
+void hashmap_clear (hashmap *hash_map);
+
 /**
  * Inserts a new in_pair to the hash map.
  * The function inserts *new*, *copied*, *dynamically allocated* in_pair,
@@ -102,6 +438,42 @@ void hashmap_free (hashmap **p_hash_map);
  */
 int hashmap_insert (hashmap *hash_map, const pair *in_pair);
 
+/**
+ * Inserts in_pair itself to the hash map, without copying it or its key and
+ * value. Upon success the hash map owns in_pair and frees it when it is
+ * erased, upon failure the caller still owns it.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param in_pair dynamically allocated pair, usually one which adopted or
+ * borrowed its key and value (see pair_alloc).
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int hashmap_insert_owned (hashmap *hash_map, pair *in_pair);
+
+/**
+ * Inserts a copy of in_pair to the hash map (like hashmap_insert), which
+ * expires ttl time units (see hashmap_config.clock) from now. An expired
+ * pair is treated as missing by the lookups (and reclaimed by those that may
+ * change the hash map), and reclaimed by hashmap_expire_step.
+ * @param hash_map the hash map to be inserted with new element.
+ * @param in_pair a in_pair the hash map would contain.
+ * @param ttl the time to live of the pair.
+ * @return returns 1 for successful insertion, 0 otherwise.
+ */
+int hashmap_insert_ttl (hashmap *hash_map, const pair *in_pair,
+                        unsigned long long ttl);
+
+/**
+ * Erases up to budget pairs which expired by now, advancing a timer wheel
+ * instead of scanning the buckets, so it can be called often with a small
+ * budget.
+ * @param hash_map a hash map.
+ * @param now the current time (see hashmap_config.clock).
+ * @param budget the maximal number of pairs to erase.
+ * @return the number of erased pairs.
+ */
+size_t hashmap_expire_step (hashmap *hash_map, unsigned long long now,
+                            size_t budget);
+
 /**
  * The function returns the value associated with the given key.
  * @param hash_map a hash map.
@@ -112,7 +484,36 @@ int hashmap_insert (hashmap *hash_map, const pair *in_pair);
 valueT hashmap_at (const hashmap *hash_map, const_keyT key);
 
 /**
- * The function erases the pair associated with key.
+ * The function returns a pointer to the value slot of the pair associated
+ * with key, through which the value can be read, changed in place or
+ * replaced (then freeing the old value is up to the caller).
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @return pointer to the value slot if key exists, NULL otherwise, also for
+ * a key-only pair (see pair_type), whose key must not change under its
+ * cached hash. The slot stays valid until key is erased, inserts and resizes
+ * do not move it. The slot of a value stored inline (see pair_alloc_inline)
+ * may only be used to change the value in place, never replaced.
+ */
+valueT *hashmap_at_mut (hashmap *hash_map, const_keyT key);
+
+/**
+ * The function returns a pointer to the value slot of the pair associated
+ * with key, inserting the pair made by default_factory if key is missing.
+ * The key is hashed and searched only once.
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @param default_factory makes a dynamically allocated pair for key (the
+ * hash map takes ownership of it, see hashmap_insert_owned). A pair of
+ * another key, or a key-only pair, is freed and not inserted.
+ * @return pointer to the value slot (see hashmap_at_mut), NULL upon failure.
+ */
+valueT *hashmap_get_or_insert_default (hashmap *hash_map, const_keyT key,
+                                       pair_factory default_factory);
+
+/**
+ * The function erases the pair associated with key. In a multimap, it erases
+ * the first inserted pair of key.
  * @param hash_map a hash map.
  * @param key a key of the pair to be erased.
  * @return 1 if the erasing was done successfully, 0 otherwise. (if key not in map,
@@ -120,6 +521,29 @@ valueT hashmap_at (const hashmap *hash_map, const_keyT key);
  */
 int hashmap_erase (hashmap *hash_map, const_keyT key);
 
+/**
+ * The function calls visit on every pair associated with key (more than one
+ * in a multimap), in insertion order. The pairs of a key are adjacent in
+ * their bucket, so they are walked contiguously.
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @param visit called with the key, value (which it may change in place) and
+ * ctx of each pair. It must not change the hash map.
+ * @param ctx passed to visit.
+ * @return the number of visited pairs.
+ */
+size_t hashmap_equal_range (const hashmap *hash_map, const_keyT key,
+                            hashmap_visit_func visit, void *ctx);
+
+/**
+ * The function returns the number of pairs associated with key (0 or 1,
+ * unless the hash map is a multimap).
+ * @param hash_map a hash map.
+ * @param key the key to be checked.
+ * @return the number of pairs of key.
+ */
+size_t hashmap_count (const hashmap *hash_map, const_keyT key);
+
 /**
  * This function returns the load factor of the hash map.
  * @param hash_map a hash map.
@@ -127,6 +551,15 @@ int hashmap_erase (hashmap *hash_map, const_keyT key);
  */
 double hashmap_get_load_factor (const hashmap *hash_map);
 
+/**
+ * This function fills stats with a snapshot of the hash map's bucket
+ * occupancy, chain lengths and runtime counters.
+ * @param hash_map a hash map.
+ * @param stats the stats to be filled.
+ * @return 1 upon success, 0 otherwise.
+ */
+int hashmap_get_stats (const hashmap *hash_map, hashmap_stats *stats);
+
 /**
  * This function receives a hashmap and 2 functions, the first checks a condition on the keys,
  * and the seconds apply some modification on the values. The function should apply the modification
@@ -141,4 +574,59 @@ double hashmap_get_load_factor (const hashmap *hash_map);
  * @return number of changed values
  */
 int hashmap_apply_if (const hashmap *hash_map, keyT_func keyT_func, valueT_func valT_func);//const
+
+/**
+ * This function calls visit on every pair of the hash map (in insertion
+ * order with config->compact, in no particular order otherwise).
+ * @param hash_map a hashmap
+ * @param visit called with the key, value (which it may change in place) and
+ * ctx of each pair. It must not change the hash map.
+ * @param ctx passed to visit.
+ * @return number of visited pairs
+ */
+size_t hashmap_foreach (const hashmap *hash_map, hashmap_visit_func visit,
+                        void *ctx);
+
+/**
+ * This function grows the hash map once, so it can take size pairs without
+ * resizing (e.g. before inserting the pairs of several hash maps).
+ * @param hash_map
+ * @param size the number of pairs the hash map should hold, capped by
+ * max_entries.
+ * @return 1 upon success, 0 upon failure (then the hash map is unchanged).
+ */
+int hashmap_reserve (hashmap *hash_map, size_t size);
+
+/**
+ * This function inserts copies of the pairs of src to dst. dst is grown
+ * once, up front, and the hashes cached in src are reused when both hash
+ * maps hash keys the same way (same funcs, mix_hash and seed).
+ * @param dst the hash map to be merged into.
+ * @param src the hash map to be merged, unchanged. Its pairs must not have
+ * adopted their keys or values (see hashmap_insert_owned), since the copies
+ * can not share them: such a src is rejected before dst is changed.
+ * @param conflict called with the value in dst and the value in src of a
+ * key which is in both (and not in a multimap dst), to merge the latter
+ * into the former in place. NULL to keep the value in dst.
+ * @return 1 upon success, 0 otherwise (then dst may hold part of src).
+ * Expired pairs of src are skipped, and the copies get no TTL.
+ */
+int hashmap_merge (hashmap *dst, const hashmap *src,
+                   hashmap_merge_func conflict);
+
+/**
+ * This function inserts to out copies of the pairs of a whose keys are also
+ * in b. The smaller of a and b is visited and its keys are looked up in the
+ * other one, out is grown once, up front, and cached hashes are reused
+ * between hash maps which hash keys the same way.
+ * @param a the hash map whose pairs are copied, which must not have
+ * adopted their keys or values (then out is left unchanged and 0 returned).
+ * @param b the hash map whose keys are kept.
+ * @param out the hash map to be inserted with the intersection, keys which
+ * are in it already are left as they are.
+ * @return 1 upon success, 0 otherwise (then out may hold part of the
+ * intersection). Expired pairs are skipped, and the copies get no TTL.
+ */
+int hashmap_intersect (const hashmap *a, const hashmap *b, hashmap *out);
+
 #endif //HASHMAP_H_
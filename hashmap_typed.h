@@ -0,0 +1,261 @@
+#ifndef HASHMAP_TYPED_H_
+#define HASHMAP_TYPED_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "hashmap.h"
+
+/**
+ * @def HASHMAP_TYPED_MIX
+ * Fibonacci multiplier used to spread the user hash over the table before
+ * masking, so identity hashes (ints, aligned pointers) do not cluster.
+ */
+#define HASHMAP_TYPED_MIX 0x9E3779B97F4A7C15ULL
+
+/**
+ * @def HASHMAP_HASH_INTEGER, HASHMAP_EQ_VALUE
+ * Ready-made hash_expr / eq_expr for integral and pointer keys.
+ */
+#define HASHMAP_HASH_INTEGER(key) ((size_t) (key))
+#define HASHMAP_EQ_VALUE(key_1, key_2) ((key_1) == (key_2))
+
+/**
+ * @def HASHMAP_DEFINE
+ * Generates a type-specialized hash map called <b>name</b> which maps KeyT to
+ * ValueT. Keys and values are stored unboxed inside the table (open
+ * addressing, linear probing, backward-shift erase), and hash_expr(key) and
+ * eq_expr(key_1, key_2) are expanded in place, so the compiler can inline
+ * both. The generated map follows the growth and load factor rules of
+ * hashmap (HASH_MAP_INITIAL_CAP, HASH_MAP_GROWTH_FACTOR,
+ * HASH_MAP_MAX_LOAD_FACTOR, HASH_MAP_MIN_LOAD_FACTOR).
+ *
+ * Generated API (all static inline):
+ *   name *name_alloc (void);
+ *   void name_free (name **p_map);
+ *   int name_insert (name *map, KeyT key, ValueT value);
+ *   ValueT *name_at (const name *map, KeyT key);
+ *   int name_erase (name *map, KeyT key);
+ *   double name_get_load_factor (const name *map);
+ *
+ * Example:
+ *   HASHMAP_DEFINE(int_map, int, int, HASHMAP_HASH_INTEGER, HASHMAP_EQ_VALUE)
+ */
+#define HASHMAP_DEFINE(name, KeyT, ValueT, hash_expr, eq_expr)                \
+                                                                              \
+/**                                                                           \
+ * @struct name##_entry - a single slot of the table.                         \
+ * @param used 1 if the slot holds a key, 0 else.                             \
+ */                                                                           \
+typedef struct name##_entry {                                                 \
+    KeyT key;                                                                 \
+    ValueT value;                                                             \
+    unsigned char used;                                                       \
+} name##_entry;                                                               \
+                                                                              \
+/**                                                                           \
+ * @struct name - typed hash map.                                             \
+ * @param entries array of capacity slots.                                    \
+ * @param size the number of keys stored in the map.                          \
+ * @param capacity the number of slots, always a power of 2.                  \
+ */                                                                           \
+typedef struct name {                                                         \
+    name##_entry *entries;                                                    \
+    size_t size;                                                              \
+    size_t capacity;                                                          \
+} name;                                                                       \
+                                                                              \
+/**                                                                           \
+ * calculates the home slot of a key                                          \
+ */                                                                           \
+static inline size_t name##_index (size_t capacity, KeyT key)                 \
+{                                                                             \
+  uint64_t mixed = (uint64_t) (hash_expr (key)) * HASHMAP_TYPED_MIX;          \
+  mixed ^= mixed >> 32;                                                       \
+  return (size_t) mixed & (capacity - 1);                                     \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * Allocates dynamically new typed hash map.                                  \
+ * @return pointer to dynamically allocated map, NULL upon failure.          \
+ */                                                                           \
+static inline name *name##_alloc (void)                                       \
+{                                                                             \
+  name *map = (name *) malloc (sizeof (name));                                \
+  if (map == NULL)                                                            \
+    {                                                                         \
+      return NULL;                                                            \
+    }                                                                         \
+  map->entries = (name##_entry *) calloc (HASH_MAP_INITIAL_CAP,               \
+                                          sizeof (name##_entry));             \
+  if (map->entries == NULL)                                                   \
+    {                                                                         \
+      free (map);                                                             \
+      return NULL;                                                            \
+    }                                                                         \
+  map->size = 0;                                                              \
+  map->capacity = HASH_MAP_INITIAL_CAP;                                       \
+  return map;                                                                 \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * Frees a typed hash map.                                                    \
+ * @param p_map pointer to dynamically allocated pointer to map.              \
+ */                                                                           \
+static inline void name##_free (name **p_map)                                 \
+{                                                                             \
+  if (p_map == NULL || *p_map == NULL)                                        \
+    {                                                                         \
+      return;                                                                 \
+    }                                                                         \
+  free ((*p_map)->entries);                                                   \
+  free (*p_map);                                                              \
+  *p_map = NULL;                                                              \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * rehashes all the entries into a table of new_capacity slots                \
+ * @return 1 upon success 0 upon failure (map is left untouched)              \
+ */                                                                           \
+static inline int name##_rehash (name *map, size_t new_capacity)              \
+{                                                                             \
+  name##_entry *entries = (name##_entry *) calloc (new_capacity,              \
+                                                   sizeof (name##_entry));    \
+  if (entries == NULL)                                                        \
+    {                                                                         \
+      return 0;                                                               \
+    }                                                                         \
+  for (size_t i = 0; i < map->capacity; i++)                                  \
+    {                                                                         \
+      if (!map->entries[i].used)                                              \
+        {                                                                     \
+          continue;                                                           \
+        }                                                                     \
+      size_t ind = name##_index (new_capacity, map->entries[i].key);          \
+      while (entries[ind].used)                                               \
+        {                                                                     \
+          ind = (ind + 1) & (new_capacity - 1);                               \
+        }                                                                     \
+      entries[ind] = map->entries[i];                                         \
+    }                                                                         \
+  free (map->entries);                                                        \
+  map->entries = entries;                                                     \
+  map->capacity = new_capacity;                                               \
+  return 1;                                                                   \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * finds the slot of key                                                      \
+ * @return index of the slot holding key, capacity if key not in map         \
+ */                                                                           \
+static inline size_t name##_find (const name *map, KeyT key)                  \
+{                                                                             \
+  size_t ind = name##_index (map->capacity, key);                             \
+  while (map->entries[ind].used)                                              \
+    {                                                                         \
+      if (eq_expr (map->entries[ind].key, key))                               \
+        {                                                                     \
+          return ind;                                                         \
+        }                                                                     \
+      ind = (ind + 1) & (map->capacity - 1);                                  \
+    }                                                                         \
+  return map->capacity;                                                       \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * Inserts a new key and value to the map.                                    \
+ * @return 1 for successful insertion, 0 if key already in map or upon       \
+ * failure.                                                                   \
+ */                                                                           \
+static inline int name##_insert (name *map, KeyT key, ValueT value)           \
+{                                                                             \
+  if (map == NULL || name##_find (map, key) != map->capacity)                 \
+    {                                                                         \
+      return 0;                                                               \
+    }                                                                         \
+  if ((double) (map->size + 1) / map->capacity > HASH_MAP_MAX_LOAD_FACTOR     \
+      && !name##_rehash (map, map->capacity * HASH_MAP_GROWTH_FACTOR))        \
+    {                                                                         \
+      return 0;                                                               \
+    }                                                                         \
+  size_t ind = name##_index (map->capacity, key);                             \
+  while (map->entries[ind].used)                                              \
+    {                                                                         \
+      ind = (ind + 1) & (map->capacity - 1);                                  \
+    }                                                                         \
+  map->entries[ind].key = key;                                                \
+  map->entries[ind].value = value;                                            \
+  map->entries[ind].used = 1;                                                 \
+  map->size++;                                                                \
+  return 1;                                                                   \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * The function returns a pointer to the value associated with key.          \
+ * @return pointer to the stored value (valid until the next insert or       \
+ * erase), NULL if key not in map.                                            \
+ */                                                                           \
+static inline ValueT *name##_at (const name *map, KeyT key)                   \
+{                                                                             \
+  if (map == NULL)                                                            \
+    {                                                                         \
+      return NULL;                                                            \
+    }                                                                         \
+  size_t ind = name##_find (map, key);                                        \
+  if (ind == map->capacity)                                                   \
+    {                                                                         \
+      return NULL;                                                            \
+    }                                                                         \
+  return &map->entries[ind].value;                                            \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * The function erases key from the map.                                      \
+ * @return 1 if the erasing was done successfully, 0 otherwise.              \
+ */                                                                           \
+static inline int name##_erase (name *map, KeyT key)                          \
+{                                                                             \
+  if (map == NULL)                                                            \
+    {                                                                         \
+      return 0;                                                               \
+    }                                                                         \
+  size_t hole = name##_find (map, key);                                       \
+  if (hole == map->capacity)                                                  \
+    {                                                                         \
+      return 0;                                                               \
+    }                                                                         \
+  size_t mask = map->capacity - 1;                                            \
+  size_t ind = (hole + 1) & mask;                                             \
+  while (map->entries[ind].used)                                              \
+    {                                                                         \
+      size_t home = name##_index (map->capacity, map->entries[ind].key);      \
+      if (((ind - home) & mask) >= ((ind - hole) & mask))                     \
+        {                                                                     \
+          map->entries[hole] = map->entries[ind];                             \
+          hole = ind;                                                         \
+        }                                                                     \
+      ind = (ind + 1) & mask;                                                 \
+    }                                                                         \
+  map->entries[hole].used = 0;                                                \
+  map->size--;                                                                \
+  if ((double) map->size / map->capacity < HASH_MAP_MIN_LOAD_FACTOR           \
+      && map->capacity > HASH_MAP_INITIAL_CAP)                                \
+    {                                                                         \
+      name##_rehash (map, map->capacity / HASH_MAP_GROWTH_FACTOR);            \
+    }                                                                         \
+  return 1;                                                                   \
+}                                                                             \
+                                                                              \
+/**                                                                           \
+ * This function returns the load factor of the map.                          \
+ * @return the map's load factor, -1 if the function failed.                 \
+ */                                                                           \
+static inline double name##_get_load_factor (const name *map)                 \
+{                                                                             \
+  if (map == NULL)                                                            \
+    {                                                                         \
+      return -1;                                                              \
+    }                                                                         \
+  return (double) map->size / map->capacity;                                  \
+}
+
+#endif //HASHMAP_TYPED_H_
@@ -0,0 +1,419 @@
+#include "hashset.h"
+
+#define ZERO 0
+#define ONE 1
+#define FAIL 0
+#define SUCCESS 1
+
+/**
+ * @struct hashset_op - a set algebra operation in progress: the keys visited
+ * are checked against other and added to (or erased from) result.
+ */
+typedef struct hashset_op {
+    hashset *result;
+    const hashset *other;
+    int failed;
+} hashset_op;
+
+/**
+ * @struct hashset_visit - the visit func and its ctx of hashset_foreach
+ */
+typedef struct hashset_visit {
+    hashset_visit_func visit;
+    void *ctx;
+} hashset_visit;
+
+/**
+ * Allocates dynamically a new empty set.
+ * @param func a function which "hashes" keys.
+ * @param key_cpy, key_cmp, key_free funcs of the keys.
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_alloc (hash_func func, pair_key_cpy key_cpy,
+                        pair_key_cmp key_cmp, pair_key_free key_free)
+{
+  if (func == NULL || key_cmp == NULL)
+    {
+      return NULL;
+    }
+  hashset *set = (hashset *) malloc (sizeof (hashset));
+  if (set == NULL)
+    {
+      return NULL;
+    }
+  set->map = hashmap_alloc (func);
+  if (set->map == NULL)
+    {
+      free (set);
+      return NULL;
+    }
+  pair_type type = {key_cpy, NULL, key_cmp, NULL, key_free, NULL, ZERO,
+                    ZERO, ZERO, ONE, NULL};
+  set->type = type;
+  return set;
+}
+
+/**
+ * Frees a set and the keys it copied.
+ * @param p_set pointer to dynamically allocated pointer to set.
+ */
+void hashset_free (hashset **p_set)
+{
+  if (p_set == NULL || *p_set == NULL)
+    {
+      return;
+    }
+  hashmap_free (&(*p_set)->map);
+  free (*p_set);
+  *p_set = NULL;
+}
+
+/**
+ * Inserts (a copy of) key to the set.
+ * @param set
+ * @param key
+ * @return 1 if key was inserted, 0 if it is in the set already or upon
+ * failure.
+ */
+int hashset_insert (hashset *set, const_keyT key)
+{
+  // a present key is left to the caller, even by a set adopting its keys
+  if (set == NULL || key == NULL || hashset_contains (set, key))
+    {
+      return FAIL;
+    }
+  pair *new_pair = pair_alloc_type (key, NULL, &set->type);
+  if (new_pair == NULL)
+    {
+      return FAIL;
+    }
+  if (new_pair->key == NULL
+      || hashmap_insert_owned (set->map, new_pair) == FAIL)
+    {
+      if (set->type.key_cpy == NULL)
+        {
+          // the key was not adopted, it is still the caller's
+          pair_release ((void **) &new_pair);
+          return FAIL;
+        }
+      pair_free ((void **) &new_pair);
+      return FAIL;
+    }
+  return SUCCESS;
+}
+
+/**
+ * @param set
+ * @param key
+ * @return 1 if key is in the set, 0 otherwise.
+ */
+int hashset_contains (const hashset *set, const_keyT key)
+{
+  return set != NULL && hashmap_at (set->map, key) != NULL;
+}
+
+/**
+ * Erases key from the set.
+ * @param set
+ * @param key
+ * @return 1 if key was erased, 0 if it is not in the set.
+ */
+int hashset_erase (hashset *set, const_keyT key)
+{
+  if (set == NULL)
+    {
+      return FAIL;
+    }
+  return hashmap_erase (set->map, key);
+}
+
+/**
+ * @param set
+ * @return the number of keys in the set, 0 if set is NULL.
+ */
+size_t hashset_size (const hashset *set)
+{
+  return set != NULL ? set->map->size : ZERO;
+}
+
+/**
+ * calls the visit func of hashset_foreach on a key
+ * @param key
+ * @param value the key itself (see pair_value)
+ * @param ctx pointer to hashset_visit
+ */
+void hashset_visit_key (const_keyT key, valueT value, void *ctx)
+{
+  (void) value;
+  hashset_visit *visit = (hashset_visit *) ctx;
+  visit->visit (key, visit->ctx);
+}
+
+/**
+ * Calls visit on every key of the set.
+ * @param set
+ * @param visit called with each key and ctx, it must not change the set.
+ * @param ctx passed to visit.
+ * @return the number of visited keys.
+ */
+size_t hashset_foreach (const hashset *set, hashset_visit_func visit,
+                        void *ctx)
+{
+  if (set == NULL || visit == NULL)
+    {
+      return ZERO;
+    }
+  hashset_visit set_visit = {visit, ctx};
+  return hashmap_foreach (set->map, hashset_visit_key, &set_visit);
+}
+
+/**
+ * adds a key to the result of an operation, unless it is there already
+ * @param op
+ * @param key
+ */
+void hashset_op_add (hashset_op *op, const_keyT key)
+{
+  if (hashset_insert (op->result, key) == FAIL
+      && hashset_contains (op->result, key) == FAIL)
+    {
+      op->failed = ONE;
+    }
+}
+
+/**
+ * adds a visited key to the result
+ * @param key
+ * @param value
+ * @param ctx pointer to hashset_op
+ */
+void hashset_add_key (const_keyT key, valueT value, void *ctx)
+{
+  (void) value;
+  hashset_op_add ((hashset_op *) ctx, key);
+}
+
+/**
+ * adds a visited key to the result if it is in the other set
+ * @param key
+ * @param value
+ * @param ctx pointer to hashset_op
+ */
+void hashset_add_key_if_in (const_keyT key, valueT value, void *ctx)
+{
+  (void) value;
+  hashset_op *op = (hashset_op *) ctx;
+  if (hashset_contains (op->other, key))
+    {
+      hashset_op_add (op, key);
+    }
+}
+
+/**
+ * adds a visited key to the result if it is not in the other set
+ * @param key
+ * @param value
+ * @param ctx pointer to hashset_op
+ */
+void hashset_add_key_if_not_in (const_keyT key, valueT value, void *ctx)
+{
+  (void) value;
+  hashset_op *op = (hashset_op *) ctx;
+  if (!hashset_contains (op->other, key))
+    {
+      hashset_op_add (op, key);
+    }
+}
+
+/**
+ * erases a visited key from the result
+ * @param key
+ * @param value
+ * @param ctx pointer to hashset_op
+ */
+void hashset_erase_key (const_keyT key, valueT value, void *ctx)
+{
+  (void) value;
+  hashset_erase (((hashset_op *) ctx)->result, key);
+}
+
+/**
+ * makes a new empty set for an operation on a and b, with the funcs of a. If
+ * a adopts its keys, the new set borrows them instead: it must never free a
+ * key it did not allocate.
+ * @param a, b
+ * @param op the operation to be started
+ * @return 1 upon success 0 upon failure
+ */
+int hashset_op_start (const hashset *a, const hashset *b, hashset_op *op)
+{
+  if (a == NULL || b == NULL)
+    {
+      return FAIL;
+    }
+  op->result = hashset_alloc (a->map->hash_func, a->type.key_cpy,
+                              a->type.key_cmp, a->type.key_cpy != NULL
+                                               ? a->type.key_free : NULL);
+  op->failed = ZERO;
+  return op->result != NULL;
+}
+
+/**
+ * @param set
+ * @return 1 if the set adopts its keys, so its pairs can not be copied (see
+ * hashmap_merge)
+ */
+int hashset_adopts (const hashset *set)
+{
+  return set->type.key_cpy == NULL && set->type.key_free != NULL;
+}
+
+/**
+ * @param a, b
+ * @return 1 if the sets make their pairs with the same key funcs, so copies
+ * of the pairs of b are made the way a makes its own
+ */
+int hashset_same_keys (const hashset *a, const hashset *b)
+{
+  return a->type.key_cpy == b->type.key_cpy
+         && a->type.key_cmp == b->type.key_cmp
+         && a->type.key_free == b->type.key_free
+         && a->type.key_only == b->type.key_only;
+}
+
+/**
+ * visits a set with a step of an operation
+ * @param op
+ * @param set the set whose keys are visited
+ * @param other the set the step checks the keys against
+ * @param step
+ * @return 1 upon success 0 upon failure (then the result is freed)
+ */
+int hashset_op_step (hashset_op *op, const hashset *set,
+                     const hashset *other, hashmap_visit_func step)
+{
+  op->other = other;
+  hashmap_foreach (set->map, step, op);
+  if (op->failed)
+    {
+      hashset_free (&op->result);
+      return FAIL;
+    }
+  return SUCCESS;
+}
+
+/**
+ * Makes a new set of the keys which are in a or in b. The new set is grown
+ * once for both, then the larger set is copied to it and the keys of the
+ * smaller one are added, reusing the hashes cached in a and b if b makes its
+ * keys with the funcs of a and a does not adopt its keys.
+ * The sets must hold the same type of keys, the new set takes the funcs of a.
+ * @param a, b
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_union (const hashset *a, const hashset *b)
+{
+  hashset_op op;
+  if (hashset_op_start (a, b, &op) == FAIL)
+    {
+      return NULL;
+    }
+  const hashset *larger = hashset_size (a) >= hashset_size (b) ? a : b;
+  const hashset *smaller = larger == a ? b : a;
+  if (hashmap_reserve (op.result->map, hashset_size (a) + hashset_size (b))
+      == FAIL)
+    {
+      hashset_free (&op.result);
+      return NULL;
+    }
+  // merged pairs keep the funcs of their set, so only sets making their
+  // pairs like a are merged
+  if (!hashset_adopts (a) && hashset_same_keys (a, b))
+    {
+      if (hashmap_merge (op.result->map, larger->map, NULL) == FAIL
+          || hashmap_merge (op.result->map, smaller->map, NULL) == FAIL)
+        {
+          hashset_free (&op.result);
+          return NULL;
+        }
+      return op.result;
+    }
+  if (hashset_op_step (&op, larger, NULL, hashset_add_key) == FAIL
+      || hashset_op_step (&op, smaller, NULL, hashset_add_key) == FAIL)
+    {
+      return NULL;
+    }
+  return op.result;
+}
+
+/**
+ * Makes a new set of the keys which are in both a and b, by looking the keys
+ * of the smaller set up in the larger one, with their cached hashes unless a
+ * adopts its keys.
+ * The sets must hold the same type of keys, the new set takes the funcs of a.
+ * @param a, b
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_intersection (const hashset *a, const hashset *b)
+{
+  hashset_op op;
+  if (hashset_op_start (a, b, &op) == FAIL)
+    {
+      return NULL;
+    }
+  if (!hashset_adopts (a))
+    {
+      if (hashmap_intersect (a->map, b->map, op.result->map) == FAIL)
+        {
+          hashset_free (&op.result);
+          return NULL;
+        }
+      return op.result;
+    }
+  const hashset *larger = hashset_size (a) >= hashset_size (b) ? a : b;
+  const hashset *smaller = larger == a ? b : a;
+  if (hashset_op_step (&op, smaller, larger, hashset_add_key_if_in) == FAIL)
+    {
+      return NULL;
+    }
+  return op.result;
+}
+
+/**
+ * Makes a new set of the keys which are in a and not in b. If a is smaller,
+ * its keys are looked up in b, otherwise a is copied (reusing its cached
+ * hashes unless it adopts its keys) and the keys of b are erased from the
+ * copy.
+ * The sets must hold the same type of keys, the new set takes the funcs of a.
+ * @param a, b
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_difference (const hashset *a, const hashset *b)
+{
+  hashset_op op;
+  if (hashset_op_start (a, b, &op) == FAIL)
+    {
+      return NULL;
+    }
+  if (hashset_size (a) <= hashset_size (b))
+    {
+      if (hashset_op_step (&op, a, b, hashset_add_key_if_not_in) == FAIL)
+        {
+          return NULL;
+        }
+      return op.result;
+    }
+  if (!hashset_adopts (a)
+      && hashmap_merge (op.result->map, a->map, NULL) == FAIL)
+    {
+      hashset_free (&op.result);
+      return NULL;
+    }
+  if ((hashset_adopts (a)
+       && hashset_op_step (&op, a, NULL, hashset_add_key) == FAIL)
+      || hashset_op_step (&op, b, NULL, hashset_erase_key) == FAIL)
+    {
+      return NULL;
+    }
+  return op.result;
+}
@@ -0,0 +1,123 @@
+#ifndef HASHSET_H_
+#define HASHSET_H_
+
+#include <stdlib.h>
+#include "hashmap.h"
+
+/**
+ * @typedef hashset_visit_func
+ * A function that is called with a key of a set and a context pointer of the
+ * caller.
+ */
+typedef void (*hashset_visit_func) (const_keyT, void *);
+
+/**
+ * @struct hashset - a set of keys, stored in the buckets of a hash map. The
+ * pairs of the set are key-only (see pair_type): they are allocated without
+ * a value, so no value is stored, copied, compared or freed.
+ * @param map the hash map holding the keys.
+ * @param type the key-only type shared by the pairs (see pair_alloc_type):
+ * the key funcs of the set, key_cpy and key_free may be NULL for borrowed
+ * keys.
+ */
+typedef struct hashset {
+    hashmap *map;
+    pair_type type;
+} hashset;
+
+/**
+ * Allocates dynamically a new empty set.
+ * @param func a function which "hashes" keys.
+ * @param key_cpy, key_cmp, key_free funcs of the keys. With a NULL key_cpy
+ * and a key_free, the set adopts the keys inserted to it (see pair_alloc).
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_alloc (hash_func func, pair_key_cpy key_cpy,
+                        pair_key_cmp key_cmp, pair_key_free key_free);
+
+/**
+ * Frees a set and the keys it copied.
+ * @param p_set pointer to dynamically allocated pointer to set.
+ */
+void hashset_free (hashset **p_set);
+
+/**
+ * Inserts (a copy of) key to the set.
+ * @param set
+ * @param key
+ * @return 1 if key was inserted, 0 if it is in the set already or upon
+ * failure. A set adopting its keys adopts key upon success only, otherwise
+ * key is still the caller's.
+ */
+int hashset_insert (hashset *set, const_keyT key);
+
+/**
+ * @param set
+ * @param key
+ * @return 1 if key is in the set, 0 otherwise.
+ */
+int hashset_contains (const hashset *set, const_keyT key);
+
+/**
+ * Erases key from the set.
+ * @param set
+ * @param key
+ * @return 1 if key was erased, 0 if it is not in the set.
+ */
+int hashset_erase (hashset *set, const_keyT key);
+
+/**
+ * @param set
+ * @return the number of keys in the set, 0 if set is NULL.
+ */
+size_t hashset_size (const hashset *set);
+
+/**
+ * Calls visit on every key of the set.
+ * @param set
+ * @param visit called with each key and ctx, it must not change the set.
+ * @param ctx passed to visit.
+ * @return the number of visited keys.
+ */
+size_t hashset_foreach (const hashset *set, hashset_visit_func visit,
+                        void *ctx);
+
+/**
+ * Makes a new set of the keys which are in a or in b. The new set is grown
+ * once for both, then the larger set is copied to it and the keys of the
+ * smaller one are added, reusing the hashes cached in a and b if b makes its
+ * keys with the funcs of a and a does not adopt its keys.
+ * The sets must hold the same type of keys, the new set takes the funcs of a.
+ * If a adopts its keys, the new set borrows the keys of a and b instead, so
+ * it must be freed before they are.
+ * @param a, b
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_union (const hashset *a, const hashset *b);
+
+/**
+ * Makes a new set of the keys which are in both a and b, by looking the keys
+ * of the smaller set up in the larger one, with their cached hashes unless a
+ * adopts its keys.
+ * The sets must hold the same type of keys, the new set takes the funcs of a.
+ * If a adopts its keys, the new set borrows the keys of a and b instead, so
+ * it must be freed before they are.
+ * @param a, b
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_intersection (const hashset *a, const hashset *b);
+
+/**
+ * Makes a new set of the keys which are in a and not in b. If a is smaller,
+ * its keys are looked up in b, otherwise a is copied (reusing its cached
+ * hashes unless it adopts its keys) and the keys of b are erased from the
+ * copy.
+ * The sets must hold the same type of keys, the new set takes the funcs of a.
+ * If a adopts its keys, the new set borrows the keys of a and b instead, so
+ * it must be freed before they are.
+ * @param a, b
+ * @return pointer to dynamically allocated set, NULL upon failure.
+ */
+hashset *hashset_difference (const hashset *a, const hashset *b);
+
+#endif //HASHSET_H_
@@ -1,12 +1,182 @@
+#include <stddef.h>
+#include <string.h>
 #include "pair.h"
 
+#define ZERO 0
+#define ONE 1
+#define MAX_INLINE_ALIGN 8UL
+
+/**
+ * @param size the size of an inline value
+ * @return the alignment the value is stored at: the largest power of 2
+ * dividing its size (the size of a type is a multiple of its alignment), at
+ * most MAX_INLINE_ALIGN
+ */
+size_t inline_align (size_t size)
+{
+  size_t align = size & (~size + ONE);
+  return align < MAX_INLINE_ALIGN ? align : MAX_INLINE_ALIGN;
+}
+
+/**
+ * @param type
+ * @param start the offset, from the start of the pair, where the inline key
+ * is stored
+ * @return the offset of the inline value, right after the key
+ */
+size_t inline_value_offset (const pair_type *type, size_t start)
+{
+  size_t align = inline_align (type->value_size);
+  return (start + type->key_size + align - ONE) / align * align;
+}
+
+/**
+ * @param type
+ * @return the size of the pair struct of a pair of the type, without the
+ * value of a key-only type
+ */
+size_t pair_head (const pair_type *type)
+{
+  return type->key_only ? offsetof (pair, value) : sizeof (pair);
+}
+
+/**
+ * @param type
+ * @param embed 1 if the pair holds its own copy of its type
+ * @return the offset, from the start of the pair, where the inline key is
+ * stored
+ */
+size_t inline_key_offset (const pair_type *type, int embed)
+{
+  return pair_head (type) + (embed ? sizeof (pair_type) : ZERO);
+}
+
+/**
+ * @param type
+ * @param embed 1 if the pair holds its own copy of type
+ * @return the number of bytes allocated for a pair of the type
+ */
+size_t type_bytes (const pair_type *type, int embed)
+{
+  size_t start = inline_key_offset (type, embed);
+  if (type->key_size == ZERO)
+    {
+      return start;
+    }
+  if (type->key_only)
+    {
+      return start + type->key_size;
+    }
+  return inline_value_offset (type, start) + type->value_size;
+}
+
+/**
+ * @param type
+ * @return 1 if the inline sizes and the prefix of type are valid
+ */
+int valid_type (const pair_type *type)
+{
+  return (type->key_only ? type->value_size == ZERO
+                         : (type->key_size == ZERO) == (type->value_size == ZERO))
+         && type->key_size <= PAIR_INLINE_CAP
+         && type->value_size <= PAIR_INLINE_CAP
+         && type->prefix % PAIR_PREFIX_ALIGN == ZERO;
+}
+
+/**
+ * allocates a pair of a valid type, with its prefix zeroed, its inline key
+ * and value (if any) not set yet
+ * @param type
+ * @param embed 1 to store a copy of type in the pair, 0 to share type
+ * @return dynamically allocated pair, NULL upon failure
+ */
+pair *pair_shell (const pair_type *type, int embed)
+{
+  size_t size = type->prefix + type_bytes (type, embed);
+  unsigned char *memory = type->allocator != NULL
+                          ? type->allocator->allocate (type->allocator->ctx,
+                                                       size)
+                          : malloc (size);
+  if (memory == NULL)
+    {
+      return NULL;
+    }
+  memset (memory, ZERO, type->prefix);
+  pair *p = (pair *) (memory + type->prefix);
+  if (embed)
+    {
+      pair_type *own = (pair_type *) ((unsigned char *) p + pair_head (type));
+      memcpy (own, type, sizeof (pair_type));
+      type = own;
+    }
+  p->type = type;
+  p->hash = ZERO;
+  if (type->key_size != ZERO)
+    {
+      size_t start = inline_key_offset (type, embed);
+      p->key = (unsigned char *) p + start;
+      if (!type->key_only)
+        {
+          p->value = (unsigned char *) p + inline_value_offset (type, start);
+        }
+    }
+  return p;
+}
+
+/**
+ * allocates a pair of a valid type
+ * @param key, value
+ * @param type
+ * @param embed 1 to store a copy of type in the pair, 0 to share type
+ * @return dynamically allocated pair, NULL upon failure
+ */
+pair *pair_make (const_keyT key, const_valueT value, const pair_type *type,
+                 int embed)
+{
+  if (type->key_size != ZERO
+      && (key == NULL || (value == NULL && !type->key_only)))
+    {
+      return NULL;
+    }
+  pair *p = pair_shell (type, embed);
+  if (p == NULL)
+    {
+      return NULL;
+    }
+  if (type->key_size != ZERO)
+    {
+      memcpy (p->key, key, type->key_size);
+    }
+  else
+    {
+      p->key = type->key_cpy != NULL ? type->key_cpy (key) : (keyT) key;
+    }
+  if (type->key_only)
+    {
+      return p;
+    }
+  if (type->key_size != ZERO)
+    {
+      memcpy (p->value, value, type->value_size);
+      return p;
+    }
+  p->value = type->value_cpy != NULL ? type->value_cpy (value)
+                                     : (valueT) value;
+  return p;
+}
+
 /**
  * Allocates dynamically a new pair.
+ * A NULL key_cpy (value_cpy) stores the key (value) pointer itself instead of
+ * a copy: with a NULL key_free (value_free) the key is borrowed from the
+ * caller and never freed by the pair, otherwise the pair adopts the key and
+ * frees it with key_free.
  * @param key, value - the key and value.
- * @param key_cpy, value_cpy - copy functions for key and value.
+ * @param key_cpy, value_cpy - copy functions for key and value, may be NULL.
  * @param key_cmp, value_cmp - compare functions for key and value.
- * @param key_free, value_free - free functions for key and value.
- * @return dynamically allocated pair.
+ * @param key_free, value_free - free functions for key and value, may be
+ * NULL.
+ * @return dynamically allocated pair, NULL upon failure.
  */
 pair *pair_alloc (
     const_keyT key, const_valueT value,
@@ -14,22 +184,160 @@ pair *pair_alloc (
     const pair_key_cmp key_cmp, const pair_value_cmp value_cmp,
     const pair_key_free key_free, const pair_value_free value_free)
 {
-  pair *p = malloc (sizeof (pair));
-  p->key = key_cpy (key);
-  p->value = value_cpy (value);
-  p->key_cpy = key_cpy;
-  p->value_cpy = value_cpy;
-  p->key_cmp = key_cmp;
-  p->value_cmp = value_cmp;
-  p->key_free = key_free;
-  p->value_free = value_free;
-  return p;
+  pair_type type = {key_cpy, value_cpy, key_cmp, value_cmp, key_free,
+                    value_free, ZERO, ZERO, ZERO, ZERO, NULL};
+  return pair_make (key, value, &type, ONE);
+}
+
+/**
+ * Allocates dynamically a new pair whose key and value are stored inline,
+ * inside the pair. The key and value are copied bytewise, and no copy or free
+ * functions are called for them.
+ * @param key, value - the key and value.
+ * @param key_size, value_size - sizes of the key and value, at most
+ * PAIR_INLINE_CAP each.
+ * @param key_cmp, value_cmp - compare functions for key and value.
+ * @return dynamically allocated pair, NULL if a size is too big or upon
+ * failure.
+ */
+pair *pair_alloc_inline (
+    const_keyT key, const_valueT value,
+    size_t key_size, size_t value_size,
+    const pair_key_cmp key_cmp, const pair_value_cmp value_cmp)
+{
+  pair_type type = {NULL, NULL, key_cmp, value_cmp, NULL, NULL, key_size,
+                    value_size, ZERO, ZERO, NULL};
+  if (key_size == ZERO || !valid_type (&type))
+    {
+      return NULL;
+    }
+  return pair_make (key, value, &type, ONE);
+}
+
+/**
+ * Allocates dynamically a new pair of the given type, which it shares: the
+ * type must outlive the pair. The key and value are copied as with
+ * pair_alloc, or bytewise if the type stores them inline.
+ * @param key, value - the key and value.
+ * @param type - the funcs, inline sizes and prefix of the pair, inline sizes
+ * are at most PAIR_INLINE_CAP and both set or both 0 (but for a key-only
+ * type). The value is ignored by a key-only type.
+ * @return dynamically allocated pair, NULL if the type is invalid or upon
+ * failure.
+ */
+pair *pair_alloc_type (const_keyT key, const_valueT value,
+                       const pair_type *type)
+{
+  if (type == NULL || !valid_type (type))
+    {
+      return NULL;
+    }
+  return pair_make (key, value, type, ZERO);
+}
+
+/**
+ * Moves the key and value of a pair to a new pair of the given type (as with
+ * pair_alloc_type), without copying or freeing them. The old pair is left to be freed with
+ * pair_release once the new one is in use.
+ * @param old_pair dynamically allocated pair.
+ * @param type - a type equal to the one of old_pair, but for its prefix.
+ * @return the new pair, NULL if the type is invalid or upon failure.
+ */
+pair *pair_move (pair *old_pair, const pair_type *type)
+{
+  if (old_pair == NULL || type == NULL || !valid_type (type))
+    {
+      return NULL;
+    }
+  pair *new_pair = pair_shell (type, ZERO);
+  if (new_pair == NULL)
+    {
+      return NULL;
+    }
+  if (type->key_size != ZERO)
+    {
+      memcpy (new_pair->key, old_pair->key, type->key_size);
+    }
+  else
+    {
+      new_pair->key = old_pair->key;
+    }
+  if (!type->key_only && type->key_size != ZERO)
+    {
+      memcpy (new_pair->value, old_pair->value, type->value_size);
+    }
+  else if (!type->key_only)
+    {
+      new_pair->value = old_pair->value;
+    }
+  new_pair->hash = old_pair->hash;
+  return new_pair;
+}
+
+/**
+ * @param type_1, type_2 - pair types.
+ * @return 1 if the types have the same funcs, inline sizes, prefix, key_only
+ * and allocator, 0 otherwise.
+ */
+int pair_type_equal (const pair_type *type_1, const pair_type *type_2)
+{
+  return type_1 == type_2
+         || (type_1->key_cpy == type_2->key_cpy
+             && type_1->value_cpy == type_2->value_cpy
+             && type_1->key_cmp == type_2->key_cmp
+             && type_1->value_cmp == type_2->value_cmp
+             && type_1->key_free == type_2->key_free
+             && type_1->value_free == type_2->value_free
+             && type_1->key_size == type_2->key_size
+             && type_1->value_size == type_2->value_size
+             && type_1->prefix == type_2->prefix
+             && type_1->key_only == type_2->key_only
+             && type_1->allocator == type_2->allocator);
+}
+
+/**
+ * @param p a pair.
+ * @return the value of the pair, its key if it holds a key only.
+ */
+valueT pair_value (const pair *p)
+{
+  return p->type->key_only ? p->key : p->value;
+}
+
+/**
+ * @param p a pair.
+ * @return the number of bytes allocated for the pair itself, with its
+ * prefix, own type and inline key and value, not including a key or value it
+ * points to.
+ */
+size_t pair_bytes (const pair *p)
+{
+  const unsigned char *own = (const unsigned char *) p + pair_head (p->type);
+  return p->type->prefix
+         + type_bytes (p->type, p->type == (const pair_type *) own);
+}
+
+/**
+ * Checks whether pair_copy can copy the pair.
+ * @param p a pair.
+ * @return 1 unless the pair adopted its key or value (which a copy can not
+ * share), 0 otherwise.
+ */
+int pair_copyable (const pair *p)
+{
+  const pair_type *type = p->type;
+  return type->key_size != ZERO
+         || !((type->key_cpy == NULL && type->key_free != NULL)
+              || (!type->key_only && type->value_cpy == NULL
+                  && type->value_free != NULL));
 }
 
 /**
  * Creates a new (dynamically allocated) copy of the given old_pair.
+ * Borrowed keys and values are shared by the copy.
  * @param old_pair old_pair to be copied.
- * @return new dynamically allocated old_pair if succeeded, NULL otherwise.
+ * @return new dynamically allocated old_pair if succeeded, NULL otherwise
+ * (also if old_pair adopted its key or value, which it can not share).
  */
 void *pair_copy (const void *p)
 {
@@ -38,10 +346,20 @@ void *pair_copy (const void *p)
       return NULL;
     }
   const pair *old_pair = (const pair *) p;
-  pair *new_pair = pair_alloc (old_pair->key, old_pair->value,
-                               old_pair->key_cpy, old_pair->value_cpy,
-                               old_pair->key_cmp, old_pair->value_cmp,
-                               old_pair->key_free, old_pair->value_free);
+  if (!pair_copyable (old_pair))
+    {
+      return NULL;
+    }
+  // the copy stands alone, outside the container of old_pair
+  pair_type type = *old_pair->type;
+  type.prefix = ZERO;
+  type.allocator = NULL;
+  pair *new_pair = pair_make (old_pair->key, pair_value (old_pair), &type,
+                              ONE);
+  if (new_pair != NULL)
+    {
+      new_pair->hash = old_pair->hash;
+    }
   return new_pair;
 }
 
@@ -55,8 +373,17 @@ int pair_cmp (const void *p1, const void *p2)
   const pair *pair1 = (const pair *) p1;
   const pair *pair2 = (const pair *) p2;
 
-  int key_cmp = pair1->key_cmp (pair1->key, pair2->key);
-  int val_cmp = pair1->value_cmp (pair1->value, pair2->value);
+  // a key-only pair has no value to compare with the value of another pair
+  if (pair1->type->key_only != pair2->type->key_only)
+    {
+      return 0;
+    }
+  int key_cmp = pair1->type->key_cmp (pair1->key, pair2->key);
+  if (pair1->type->key_only)
+    {
+      return key_cmp;
+    }
+  int val_cmp = pair1->type->value_cmp (pair1->value, pair2->value);
   return key_cmp && val_cmp;
 }
 
@@ -72,8 +399,40 @@ void pair_free (void ** p)
     }
 
   pair **p_pair = (pair **) p;
-  (*p_pair)->key_free (&(*p_pair)->key);
-  (*p_pair)->value_free (&(*p_pair)->value);
-  free (*p_pair);
-  *p_pair = NULL;
+  const pair_type *type = (*p_pair)->type;
+  if (type->key_size == ZERO && type->key_free != NULL)
+    {
+      type->key_free (&(*p_pair)->key);
+    }
+  if (!type->key_only && type->value_size == ZERO
+      && type->value_free != NULL)
+    {
+      type->value_free (&(*p_pair)->value);
+    }
+  pair_release (p);
+}
+
+/**
+ * This function frees a pair but not its key and value, which are left to
+ * whoever they were moved to.
+ * @param p_pair pointer to dynamically allocated pair to be freed.
+ */
+void pair_release (void **p)
+{
+  if (!p || !(*p))
+    {
+      return;
+    }
+  pair *old_pair = (pair *) *p;
+  const hashmap_allocator *allocator = old_pair->type->allocator;
+  unsigned char *memory = (unsigned char *) old_pair - old_pair->type->prefix;
+  if (allocator != NULL)
+    {
+      allocator->deallocate (allocator->ctx, memory, pair_bytes (old_pair));
+    }
+  else
+    {
+      free (memory);
+    }
+  *p = NULL;
 }
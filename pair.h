@@ -2,6 +2,21 @@
 #define PAIR_H_
 
 #include <stdlib.h>
+#include "allocator.h"
+
+/**
+ * @def PAIR_INLINE_CAP
+ * The maximal size (in bytes) of a key or a value that can be stored inline,
+ * inside the pair itself, instead of in a separate dynamically allocated
+ * object.
+ */
+#define PAIR_INLINE_CAP 8UL
+
+/**
+ * @def PAIR_PREFIX_ALIGN
+ * The alignment of the prefix of a pair (see pair_type), and of the pair.
+ */
+#define PAIR_PREFIX_ALIGN 8UL
 
 /**
  * @typedef keyT, valueT, const_keyT, const_valueT
@@ -34,30 +49,71 @@ typedef void (*pair_key_free) (keyT *);
 typedef void (*pair_value_free) (valueT *);
 
 /**
- * @struct pair - represent a pair '''{key: value}'''.
- * @param key, value - the key and value.
+ * @struct pair_type - the funcs and inline sizes shared by pairs of one kind,
+ * held once per kind instead of in every pair.
  * @param key_cpy, value_cpy - copy functions for key and value.
  * @param key_cmp, value_cmp - compare functions for key and value.
  * @param key_free, value_free - free functions for key and value.
+ * @param key_size, value_size - sizes of the inline key and value (see
+ * pair_alloc_inline), 0 if they are stored by pointer (see pair_alloc).
+ * @param prefix - bytes allocated (zeroed) right before each pair, for the
+ * container holding it to link it by (e.g. by recency), a multiple of
+ * PAIR_PREFIX_ALIGN.
+ * @param key_only - 1 for pairs holding a key only (e.g. the keys of a set):
+ * no value is allocated, stored, compared or freed, the value funcs and
+ * value_size are unused and the value of such a pair is its key (see
+ * pair_value). An inline key_size may then be set alone.
+ * @param allocator - allocates and frees the pairs of the type (with their
+ * prefix), e.g. the allocator of the container holding them, which must
+ * outlive them. NULL for malloc and free.
  */
-typedef struct pair {
-    keyT key;
-    valueT value;
+typedef struct pair_type {
     pair_key_cpy key_cpy;
     pair_value_cpy value_cpy;
     pair_key_cmp key_cmp;
     pair_value_cmp value_cmp;
     pair_key_free key_free;
     pair_value_free value_free;
+    size_t key_size;
+    size_t value_size;
+    size_t prefix;
+    int key_only;
+    const hashmap_allocator *allocator;
+} pair_type;
+
+/**
+ * @struct pair - represent a pair '''{key: value}'''.
+ * @param key, value - the key and value. An inline key and value are stored
+ * right after the pair, in the same allocation. value comes last so a
+ * key-only pair (see pair_type) is allocated without it.
+ * @param type - the funcs and inline sizes of the pair. A pair made by
+ * pair_alloc, pair_alloc_inline or pair_copy holds its own type, right after
+ * it; a pair made by pair_alloc_type shares the type it was given.
+ * The funcs used to be fields of the pair itself; they are now reached
+ * through the type (e.g. p->key_free is now p->type->key_free), so code
+ * reading them straight from a pair must be updated.
+ * @param hash - the full hash of the key, cached by the container holding the
+ * pair.
+ */
+typedef struct pair {
+    keyT key;
+    const pair_type *type;
+    size_t hash;
+    valueT value;
 } pair;
 
 /**
  * Allocates dynamically a new pair.
+ * A NULL key_cpy (value_cpy) stores the key (value) pointer itself instead of
+ * a copy: with a NULL key_free (value_free) the key is borrowed from the
+ * caller and never freed by the pair, otherwise the pair adopts the key and
+ * frees it with key_free.
  * @param key, value - the key and value.
- * @param key_cpy, value_cpy - copy functions for key and value.
+ * @param key_cpy, value_cpy - copy functions for key and value, may be NULL.
  * @param key_cmp, value_cmp - compare functions for key and value.
- * @param key_free, value_free - free functions for key and value.
- * @return dynamically allocated pair.
+ * @param key_free, value_free - free functions for key and value, may be
+ * NULL.
+ * @return dynamically allocated pair, NULL upon failure.
  */
 pair *pair_alloc (
     const_keyT key, const_valueT value,
@@ -65,10 +121,81 @@ pair *pair_alloc (
     pair_key_cmp key_cmp, pair_value_cmp value_cmp,
     pair_key_free key_free, pair_value_free value_free);
 
+/**
+ * Allocates dynamically a new pair whose key and value are stored inline,
+ * inside the pair. The key and value are copied bytewise, and no copy or free
+ * functions are called for them.
+ * @param key, value - the key and value.
+ * @param key_size, value_size - sizes of the key and value, at most
+ * PAIR_INLINE_CAP each.
+ * @param key_cmp, value_cmp - compare functions for key and value.
+ * @return dynamically allocated pair, NULL if a size is too big or upon
+ * failure.
+ */
+pair *pair_alloc_inline (
+    const_keyT key, const_valueT value,
+    size_t key_size, size_t value_size,
+    pair_key_cmp key_cmp, pair_value_cmp value_cmp);
+
+/**
+ * Allocates dynamically a new pair of the given type, which it shares: the
+ * type must outlive the pair. The key and value are copied as with
+ * pair_alloc, or bytewise if the type stores them inline.
+ * @param key, value - the key and value.
+ * @param type - the funcs, inline sizes and prefix of the pair, inline sizes
+ * are at most PAIR_INLINE_CAP and both set or both 0 (but for a key-only
+ * type). The value is ignored by a key-only type.
+ * @return dynamically allocated pair, NULL if the type is invalid or upon
+ * failure.
+ */
+pair *pair_alloc_type (const_keyT key, const_valueT value,
+                       const pair_type *type);
+
+/**
+ * Moves the key and value of a pair to a new pair of the given type (as with
+ * pair_alloc_type), without copying or freeing them. The old pair is left to be freed with
+ * pair_release once the new one is in use.
+ * @param old_pair dynamically allocated pair.
+ * @param type - a type equal to the one of old_pair, but for its prefix.
+ * @return the new pair, NULL if the type is invalid or upon failure.
+ */
+pair *pair_move (pair *old_pair, const pair_type *type);
+
+/**
+ * @param type_1, type_2 - pair types.
+ * @return 1 if the types have the same funcs, inline sizes, prefix, key_only
+ * and allocator, 0 otherwise.
+ */
+int pair_type_equal (const pair_type *type_1, const pair_type *type_2);
+
+/**
+ * @param p a pair.
+ * @return the value of the pair, its key if it holds a key only.
+ */
+valueT pair_value (const pair *p);
+
+/**
+ * @param p a pair.
+ * @return the number of bytes allocated for the pair itself, with its
+ * prefix, own type and inline key and value, not including a key or value it
+ * points to.
+ */
+size_t pair_bytes (const pair *p);
+
+/**
+ * Checks whether pair_copy can copy the pair.
+ * @param p a pair.
+ * @return 1 unless the pair adopted its key or value (which a copy can not
+ * share), 0 otherwise.
+ */
+int pair_copyable (const pair *p);
+
 /**
  * Creates a new (dynamically allocated) copy of the given old_pair.
+ * Borrowed keys and values are shared by the copy.
  * @param old_pair old_pair to be copied.
- * @return new dynamically allocated old_pair if succeeded, NULL otherwise.
+ * @return new dynamically allocated old_pair if succeeded, NULL otherwise
+ * (also if old_pair adopted its key or value, which it can not share).
  */
 void *pair_copy (const void *p);
 
@@ -76,7 +203,8 @@ void *pair_copy (const void *p);
  * Compares two pairs
  * @param pair1 first pair
  * @param pair2 second pair
- * @return 1 if pairs are equal on key and value, 0 else
+ * @return 1 if pairs are equal on key and value (on key only for key-only
+ * pairs), 0 else (also if only one of them is key-only)
  */
 int pair_cmp(const void *p1, const void *p2);
 
@@ -86,4 +214,11 @@ int pair_cmp(const void *p1, const void *p2);
  */
 void pair_free (void **p);
 
+/**
+ * This function frees a pair but not its key and value, which are left to
+ * whoever they were moved to.
+ * @param p_pair pointer to dynamically allocated pair to be freed.
+ */
+void pair_release (void **p);
+
 #endif //PAIR_H_
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include "test_suite.h"
+
+/**
+ * @typedef test_func
+ * A test of the suite, see test_suite.h.
+ */
+typedef void (*test_func) (void);
+
+/**
+ * @struct test_case - a test of the suite and its name, for the report.
+ */
+typedef struct test_case {
+    const char *name;
+    test_func func;
+} test_case;
+
+#define TEST_CASE(func) {#func, func}
+
+static const test_case tests[] = {
+    TEST_CASE (test_hash_map_insert),
+    TEST_CASE (test_hash_map_at),
+    TEST_CASE (test_hash_map_erase),
+    TEST_CASE (test_hash_map_get_load_factor),
+    TEST_CASE (test_hash_map_apply_if),
+    TEST_CASE (test_typed_hash_map),
+    TEST_CASE (test_hash_map_inline_pairs),
+    TEST_CASE (test_hash_map_get_stats),
+    TEST_CASE (test_hash_map_mix_hash),
+    TEST_CASE (test_hash_map_keyed_hash),
+    TEST_CASE (test_hash_map_treeify),
+    TEST_CASE (test_vector_bulk),
+    TEST_CASE (test_hash_map_clear),
+    TEST_CASE (test_hash_map_insert_owned),
+    TEST_CASE (test_hash_map_at_mut),
+    TEST_CASE (test_hash_map_bloom_filter),
+    TEST_CASE (test_hash_map_cuckoo),
+    TEST_CASE (test_hash_map_lru),
+    TEST_CASE (test_hash_map_ttl),
+    TEST_CASE (test_hash_map_compact),
+    TEST_CASE (test_hash_map_multimap),
+    TEST_CASE (test_hash_set),
+    TEST_CASE (test_hash_map_merge),
+    TEST_CASE (test_hash_map_from_arrays),
+    TEST_CASE (test_diskmap),
+    TEST_CASE (test_allocator),
+};
+
+/**
+ * Runs every test of the suite in order and prints the name of each test
+ * that passed. A failing test aborts on its assertion.
+ * @return 0 once all the tests passed.
+ */
+int main (void)
+{
+  size_t i;
+  for (i = 0; i < sizeof (tests) / sizeof (tests[0]); i++)
+    {
+      tests[i].func ();
+      printf ("%s ok\n", tests[i].name);
+    }
+  return 0;
+}
@@ -14,6 +14,7 @@ typedef struct Employee{
 #define TEST_PAIRS_H
 
 #include <stdlib.h>
+#include <string.h>
 #include "pair.h"
 
 /**
@@ -91,7 +92,7 @@ void *string_key_cpy (const_keyT key)
  */
 int string_key_cmp (const_keyT key_1, const_keyT key_2)
 {
-  return *(char *) key_1 == *(char *) key_2;
+  return strcmp ((const char *) key_1, (const char *) key_2) == 0;
 }
 
 /**
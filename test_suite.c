@@ -1,7 +1,12 @@
 #include "test_suite.h"
 #include "test_pairs.h"
 #include "hash_funcs.h"
+#include "hashmap_typed.h"
+#include "hashset.h"
+#include "diskmap.h"
 #include <stdio.h>
+#include <stddef.h>
+#include <limits.h>
 
 
 #define ONE 1
@@ -12,6 +17,8 @@
 #define EMPLOYEE 5
 #define TWO 2
 #define NEGATIVE -1
+
+HASHMAP_DEFINE(int_int_map, int, int, HASHMAP_HASH_INTEGER, HASHMAP_EQ_VALUE)
 /**
  * Function for creating new employee key string value, pair
  * @param key employee
@@ -129,10 +136,10 @@ void check_insert_inputs (hashmap *hash_map)
   char current = (char)('a'+ 30);
   pair *new_pair = create_pair (&current, &twelve, CHAR, INT);
   assert(hashmap_insert (NULL, new_pair) == ZERO);
-  new_pair->key_free(&new_pair->key);
+  new_pair->type->key_free(&new_pair->key);
   assert(hashmap_insert (hash_map, new_pair) == ZERO);
   assert(hashmap_insert (NULL, new_pair) == ZERO);
-  new_pair->value_free(&new_pair->value);
+  new_pair->type->value_free(&new_pair->value);
   assert(hashmap_insert (hash_map, new_pair) == ZERO);
   assert(hashmap_insert (NULL, new_pair) == ZERO);
   assert(hash_map->size == HASH_MAP_MAX_LOAD_FACTOR * HASH_MAP_INITIAL_CAP);
@@ -546,3 +553,1509 @@ void test_hash_map_apply_if()
   assert(hashmap_apply_if(hash_map, is_digit, double_value) == 0);
   hashmap_free(&hash_map);
 }
+
+/**
+ * This function checks the typed hash map generated by HASHMAP_DEFINE.
+ * If the typed map fails at some points, the functions exits with
+ * exit code 1.
+ */
+void test_typed_hash_map(void)
+{
+  int_int_map *map = int_int_map_alloc();
+  assert(map != NULL);
+  for (int i = ZERO; i < 1000; i++)
+    {
+      assert(int_int_map_insert(map, i * 1024, i) == ONE);
+      assert(int_int_map_insert(map, i * 1024, i) == ZERO);
+    }
+  assert(map->size == 1000);
+  assert(int_int_map_get_load_factor(map) <= HASH_MAP_MAX_LOAD_FACTOR);
+  for (int i = ZERO; i < 1000; i++)
+    {
+      assert(*int_int_map_at(map, i * 1024) == i);
+    }
+  assert(int_int_map_at(map, 3) == NULL);
+  for (int i = ZERO; i < 1000; i += TWO)
+    {
+      assert(int_int_map_erase(map, i * 1024) == ONE);
+      assert(int_int_map_erase(map, i * 1024) == ZERO);
+    }
+  for (int i = ZERO; i < 1000; i++)
+    {
+      assert((int_int_map_at(map, i * 1024) == NULL) == (i % TWO == ZERO));
+    }
+  int_int_map_free(&map);
+  assert(map == NULL);
+  assert(int_int_map_get_load_factor(NULL) == NEGATIVE);
+}
+
+/**
+ * This function checks hash map with pairs stored inline (pair_alloc_inline).
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_inline_pairs(void)
+{
+  hashmap *hash_map = hashmap_alloc(hash_char);
+  for (char key = 'a'; key <= 'z'; key++)
+    {
+      int val = key;
+      pair *new_pair = pair_alloc_inline(&key, &val, sizeof (char),
+                                         sizeof (int), char_key_cmp,
+                                         int_value_cmp);
+      assert(new_pair != NULL);
+      assert(new_pair->key != &key);
+      assert((uintptr_t) new_pair->value % sizeof (int) == ZERO);
+      // the key and value follow the pair and its own type
+      assert(pair_bytes(new_pair)
+             == sizeof (pair) + sizeof (pair_type) + TWO * sizeof (int));
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      assert(hashmap_insert(hash_map, new_pair) == ZERO);
+      pair_free((void **) &new_pair);
+    }
+  // the copies share the map's single copy of their type
+  assert(hash_map->type_count == ONE);
+  for (size_t i = ZERO; i < hash_map->capacity; i++)
+    {
+      pair **pairs = bucket_pairs(&hash_map->buckets[i]);
+      for (size_t j = ZERO; j < bucket_size(&hash_map->buckets[i]); j++)
+        {
+          assert(pairs[j]->type == hash_map->types[ZERO]);
+          assert(pair_bytes(pairs[j]) == sizeof (pair) + TWO * sizeof (int));
+        }
+    }
+  for (char key = 'a'; key <= 'z'; key++)
+    {
+      assert(*(int *) hashmap_at(hash_map, &key) == key);
+    }
+  assert(hashmap_apply_if(hash_map, is_abc, double_value) == 26);
+  char key = 'q';
+  assert(*(int *) hashmap_at(hash_map, &key) == TWO * 'q');
+  assert(hashmap_erase(hash_map, &key) == ONE);
+  assert(hashmap_at(hash_map, &key) == NULL);
+  long big = 1;
+  assert(pair_alloc_inline(&big, &big, PAIR_INLINE_CAP + ONE, sizeof (long),
+                           char_key_cmp, int_value_cmp) == NULL);
+  hashmap_free(&hash_map);
+}
+
+/**
+ * A hash func which sends all the keys to the same bucket.
+ */
+size_t hash_collide (const_keyT elem)
+{
+  (void) elem;
+  return ZERO;
+}
+
+/**
+ * This function checks the hashmap_get_stats function of the hashmap library.
+ * If hashmap_get_stats fails at some points, the functions exits with exit
+ * code 1.
+ */
+void test_hash_map_get_stats(void)
+{
+  hashmap_stats stats;
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.counters = ONE;
+  hashmap *hash_map = hashmap_alloc_config(hash_collide, &config);
+  assert(hashmap_get_stats(NULL, &stats) == ZERO);
+  assert(hashmap_get_stats(hash_map, NULL) == ZERO);
+  assert(hashmap_get_stats(hash_map, &stats) == ONE);
+  assert(stats.used_buckets == ZERO && stats.max_chain == ZERO);
+  assert(stats.chain_histogram[ZERO] == HASH_MAP_INITIAL_CAP);
+  char *value = "abc";
+  for (int i = ZERO; i < 20; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  assert(hashmap_get_stats(hash_map, &stats) == ONE);
+  assert(stats.size == 20 && stats.capacity == 32);
+  assert(stats.used_buckets == ONE && stats.max_chain == 20);
+  assert(stats.mean_chain == 20);
+  assert(stats.chain_histogram[HASH_MAP_STATS_HISTOGRAM - ONE] == ONE);
+  assert(stats.chain_histogram[ZERO] == 31);
+  assert(stats.grows == ONE && stats.shrinks == ZERO);
+  assert(stats.key_cmp_calls >= 19 * 20 / TWO);
+  assert(stats.bytes_allocated > 20 * sizeof (pair));
+  // one word per bucket, the spill array doubled from 2 up to 32 pairs, and
+  // the pairs share a single type
+  assert(sizeof(bucket) == sizeof(pair *));
+  assert(stats.bytes_allocated
+         == sizeof(hashmap) + sizeof(hashmap_counters) + 20 * sizeof(pair)
+            + sizeof(pair_type *) + sizeof(pair_type) + 32 * sizeof(bucket)
+            + sizeof(bucket_spill) + 32 * sizeof(pair *));
+  for (int i = ZERO; i < 20; i++)
+    {
+      assert(hashmap_erase(hash_map, &i) == ONE);
+    }
+  assert(hashmap_get_stats(hash_map, &stats) == ONE);
+  assert(stats.size == ZERO && stats.used_buckets == ZERO);
+  assert(stats.shrinks > ZERO);
+  hashmap_free(&hash_map);
+}
+
+/**
+ * An identity hash func for ints.
+ */
+size_t hash_identity_int (const_keyT elem)
+{
+  return (size_t) *(const int *) elem;
+}
+
+/**
+ * This function checks hash maps allocated with mix_hash.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_mix_hash(void)
+{
+  hashmap_config config;
+  memset(&config, ZERO, sizeof (hashmap_config));
+  config.mix_hash = ONE;
+  hashmap *plain = hashmap_alloc_config(hash_identity_int, NULL);
+  hashmap *mixed = hashmap_alloc_config(hash_identity_int, &config);
+  assert(hashmap_alloc_config(NULL, &config) == NULL);
+  char *value = "abc";
+  for (int i = ZERO; i < 64; i++)
+    {
+      int key = i * 1024;
+      pair *new_pair = create_pair(&key, &value, INT, STRING);
+      assert(hashmap_insert(plain, new_pair) == ONE);
+      assert(hashmap_insert(mixed, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  hashmap_stats plain_stats, mixed_stats;
+  hashmap_get_stats(plain, &plain_stats);
+  hashmap_get_stats(mixed, &mixed_stats);
+  assert(plain_stats.used_buckets == ONE);
+  assert(mixed_stats.used_buckets > 32);
+  for (int i = ZERO; i < 64; i++)
+    {
+      int key = i * 1024;
+      assert(hashmap_at(mixed, &key) != NULL);
+      assert(hashmap_erase(mixed, &key) == ONE);
+    }
+  assert(mixed->size == ZERO);
+  hashmap_free(&plain);
+  hashmap_free(&mixed);
+}
+
+/**
+ * This function checks hash maps allocated with a keyed hash func.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_keyed_hash(void)
+{
+  hashmap_seed seed = {1, 2};
+  hashmap_config config;
+  memset(&config, ZERO, sizeof (hashmap_config));
+  config.keyed_hash = hash_int_keyed;
+  config.seed = &seed;
+  hashmap *fixed = hashmap_alloc_config(NULL, &config);
+  assert(fixed != NULL);
+  assert(fixed->seed.k0 == 1 && fixed->seed.k1 == TWO);
+  config.seed = NULL;
+  hashmap *random_1 = hashmap_alloc_config(NULL, &config);
+  hashmap *random_2 = hashmap_alloc_config(NULL, &config);
+  assert(random_1->seed.k0 != random_2->seed.k0
+         || random_1->seed.k1 != random_2->seed.k1);
+  char *value = "abc";
+  for (int i = ZERO; i < 100; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(fixed, new_pair) == ONE);
+      assert(hashmap_insert(random_1, new_pair) == ONE);
+      assert(hashmap_insert(random_1, new_pair) == ZERO);
+      pair_free((void **) &new_pair);
+    }
+  for (int i = ZERO; i < 100; i++)
+    {
+      assert(hashmap_at(fixed, &i) != NULL);
+      assert(hashmap_erase(random_1, &i) == ONE);
+    }
+  assert(hash_int_keyed(&value, &seed) != hash_int_keyed(&value,
+                                                         &random_2->seed));
+  hashmap_free(&fixed);
+  hashmap_free(&random_1);
+  hashmap_free(&random_2);
+}
+
+/**
+ * An int hash func whose outputs only differ in bits above the bucket index.
+ */
+size_t hash_high_bits (const_keyT elem)
+{
+  return (size_t) *(const int *) elem << 20;
+}
+
+/**
+ * checks that a bucket is sorted by the cached hashes of its pairs
+ * @param current
+ */
+void check_bucket_sorted (const bucket *current)
+{
+  pair **pairs = bucket_pairs(current);
+  for (size_t i = ONE; i < bucket_size(current); i++)
+    {
+      assert(pairs[i - ONE]->hash <= pairs[i]->hash);
+    }
+}
+
+/**
+ * This function checks that long buckets are kept sorted (treeified) and
+ * searchable through inserts, erases and resizes.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_treeify(void)
+{
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.counters = ONE;
+  hashmap *hash_map = hashmap_alloc_config(hash_high_bits, &config);
+  char *value = "abc";
+  for (int i = 100; i > ZERO; i--)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      assert(hashmap_insert(hash_map, new_pair) == ZERO);
+      pair_free((void **) &new_pair);
+    }
+  assert(bucket_size(&hash_map->buckets[ZERO]) == 100);
+  check_bucket_sorted(&hash_map->buckets[ZERO]);
+  hashmap_stats before, after;
+  hashmap_get_stats(hash_map, &before);
+  for (int i = ONE; i <= 100; i++)
+    {
+      assert(hashmap_at(hash_map, &i) != NULL);
+    }
+  hashmap_get_stats(hash_map, &after);
+  assert(after.key_cmp_calls - before.key_cmp_calls == 100);
+  for (int i = ONE; i <= 100; i += TWO)
+    {
+      assert(hashmap_erase(hash_map, &i) == ONE);
+      check_bucket_sorted(&hash_map->buckets[ZERO]);
+    }
+  for (int i = ONE; i <= 100; i++)
+    {
+      assert((hashmap_at(hash_map, &i) == NULL) == (i % TWO == ONE));
+    }
+  hashmap_free(&hash_map);
+}
+
+/**
+ * This function checks the bulk operations of the vector: reserve,
+ * push_back_many, emplace_owned and shrink_to_fit.
+ * If the vector fails at some points, the functions exits with exit code 1.
+ */
+void test_vector_bulk(void)
+{
+  vector *vec = vector_alloc(int_key_cpy, int_key_cmp, int_key_free);
+  assert(vector_reserve(vec, 100) == ONE);
+  size_t capacity = vec->capacity;
+  void **data = vec->data;
+  assert(vector_get_load_factor(vec) == ZERO && 100.0 / capacity
+         <= VECTOR_MAX_LOAD_FACTOR);
+  int nums[100];
+  const void *values[100];
+  for (int i = ZERO; i < 100; i++)
+    {
+      nums[i] = i;
+      values[i] = &nums[i];
+    }
+  assert(vector_push_back_many(vec, values, 99) == ONE);
+  int *owned = malloc(sizeof(int));
+  *owned = 99;
+  assert(vector_emplace_owned(vec, owned) == ONE);
+  assert(vec->capacity == capacity && vec->data == data);
+  assert(vector_at(vec, 99) == owned);
+  for (int i = ZERO; i < 100; i++)
+    {
+      assert(*(int *) vector_at(vec, i) == i);
+      assert(vector_at(vec, i) != &nums[i]);
+    }
+  for (int i = 99; i >= 10; i--)
+    {
+      assert(vector_erase_unordered(vec, i) == ONE);
+    }
+  assert(vec->capacity == capacity);
+  assert(vector_shrink_to_fit(vec) == ONE);
+  assert(vec->capacity < capacity);
+  assert(vector_get_load_factor(vec) <= VECTOR_MAX_LOAD_FACTOR);
+  assert(vector_push_back(vec, &nums[10]) == ONE);
+  assert(*(int *) vector_at(vec, 10) == 10);
+  vector_free(&vec);
+}
+
+/**
+ * This function checks that clearing a hash map erases all its elements and
+ * keeps its capacity, and that the map can be refilled afterwards.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_clear(void)
+{
+  hashmap *hash_map = hashmap_alloc(hash_collide);
+  char *value = "abc";
+  for (int round = ZERO; round < TWO; round++)
+    {
+      for (int i = ZERO; i < 50; i++)
+        {
+          pair *new_pair = create_pair(&i, &value, INT, STRING);
+          assert(hashmap_insert(hash_map, new_pair) == ONE);
+          pair_free((void **) &new_pair);
+        }
+      size_t capacity = hash_map->capacity;
+      hashmap_clear(hash_map);
+      assert(hash_map->size == ZERO && hash_map->capacity == capacity);
+      for (int i = ZERO; i < 50; i++)
+        {
+          assert(hashmap_at(hash_map, &i) == NULL);
+        }
+    }
+  hashmap_clear(hash_map);
+  hashmap_clear(NULL);
+  hashmap_free(&hash_map);
+}
+
+/**
+ * This function checks inserting owned pairs (which adopted their key and
+ * value) and pairs which borrow their key and value from the caller.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_insert_owned(void)
+{
+  hashmap *hash_map = hashmap_alloc(hash_int);
+  for (int i = ZERO; i < 50; i++)
+    {
+      int *key = malloc(sizeof(int));
+      int *value = malloc(sizeof(int));
+      *key = i;
+      *value = i * TWO;
+      pair *owned = pair_alloc(key, value, NULL, NULL, int_key_cmp,
+                               int_value_cmp, int_key_free, int_value_free);
+      assert(owned->key == key && owned->value == value);
+      assert(pair_copy(owned) == NULL);
+      assert(hashmap_insert(hash_map, owned) == ZERO);
+      assert(hashmap_insert_owned(hash_map, owned) == ONE);
+      assert(hashmap_at(hash_map, &i) == value);
+    }
+  int twice = 7;
+  pair *duplicate = pair_alloc(&twice, &twice, NULL, NULL, int_key_cmp,
+                               int_value_cmp, NULL, NULL);
+  assert(hashmap_insert_owned(hash_map, duplicate) == ZERO);
+  assert(hashmap_insert_owned(NULL, duplicate) == ZERO);
+  pair_free((void **) &duplicate);
+  // adopted keys can not be shared by copies, so nothing is merged
+  hashmap *copies = hashmap_alloc(hash_int);
+  assert(hashmap_merge(copies, hash_map, NULL) == ZERO);
+  assert(hashmap_intersect(hash_map, hash_map, copies) == ZERO);
+  assert(copies->size == ZERO && copies->capacity == HASH_MAP_INITIAL_CAP);
+  assert(hashmap_merge(hash_map, copies, NULL) == ONE);
+  hashmap_free(&copies);
+  assert(hashmap_erase(hash_map, &twice) == ONE);
+  hashmap_free(&hash_map);
+
+  hash_map = hashmap_alloc(hash_int);
+  int keys[50], values[50];
+  for (int i = ZERO; i < 50; i++)
+    {
+      keys[i] = i;
+      values[i] = -i;
+      pair *borrowed = pair_alloc(&keys[i], &values[i], NULL, NULL,
+                                  int_key_cmp, int_value_cmp, NULL, NULL);
+      assert(hashmap_insert(hash_map, borrowed) == ONE);
+      pair_free((void **) &borrowed);
+      assert(hashmap_at(hash_map, &i) == &values[i]);
+    }
+  values[3] = 100;
+  int three = 3;
+  assert(*(int *) hashmap_at(hash_map, &three) == 100);
+  hashmap_clear(hash_map);
+  assert(keys[3] == 3 && values[3] == 100);
+  hashmap_free(&hash_map);
+}
+
+/**
+ * makes a new pair of key (int) with the value 0 (int), stored inline
+ * @param key
+ * @return new pair
+ */
+pair *zero_int_pair (const_keyT key)
+{
+  int zero = ZERO;
+  return pair_alloc_inline(key, &zero, sizeof(int), sizeof(int), int_key_cmp,
+                           int_value_cmp);
+}
+
+/**
+ * makes a new pair of the key after key (int) with the value 0 (int)
+ * @param key
+ * @return new pair
+ */
+pair *next_int_pair (const_keyT key)
+{
+  int next = *(const int *) key + ONE;
+  return zero_int_pair(&next);
+}
+
+/**
+ * This function checks changing values in place through hashmap_at_mut and
+ * counting keys with hashmap_get_or_insert_default.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_at_mut(void)
+{
+  hashmap *hash_map = hashmap_alloc(hash_int);
+  for (int i = ZERO; i < 1000; i++)
+    {
+      int key = i % 37;
+      valueT *slot = hashmap_get_or_insert_default(hash_map, &key,
+                                                   zero_int_pair);
+      assert(slot != NULL);
+      (*(int *) *slot)++;
+    }
+  assert(hash_map->size == 37);
+  for (int key = ZERO; key < 37; key++)
+    {
+      valueT *slot = hashmap_at_mut(hash_map, &key);
+      assert(slot != NULL && *slot == hashmap_at(hash_map, &key));
+      assert(*(int *) *slot == 1000 / 37 + (key < 1000 % 37));
+    }
+  int key = 5, other = 5000;
+  valueT *slot = hashmap_at_mut(hash_map, &key);
+  for (int i = 100; i < 200; i++)
+    {
+      valueT *new_slot = hashmap_get_or_insert_default(hash_map, &i,
+                                                       zero_int_pair);
+      assert(*(int *) *new_slot == ZERO);
+    }
+  assert(slot == hashmap_at_mut(hash_map, &key));
+  assert(hashmap_at_mut(hash_map, &other) == NULL);
+  assert(hashmap_at_mut(NULL, &key) == NULL);
+  assert(hashmap_get_or_insert_default(hash_map, &key, NULL) == NULL);
+  // a pair of another key would be filed under the wrong hash
+  size_t size = hash_map->size;
+  assert(hashmap_get_or_insert_default(hash_map, &other, next_int_pair)
+         == NULL);
+  assert(hash_map->size == size && hashmap_at(hash_map, &other) == NULL);
+  hashmap_free(&hash_map);
+}
+
+/**
+ * This function checks the Bloom filter front of the hash map: no false
+ * negatives, few false positives, and lookups staying correct through
+ * erases, resizes and clears.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_bloom_filter(void)
+{
+  bloom *filter = bloom_alloc(NULL, 1024);
+  for (size_t i = ZERO; i < 768; i++)
+    {
+      bloom_add(filter, i);
+    }
+  size_t false_positives = ZERO;
+  for (size_t i = ZERO; i < 10000; i++)
+    {
+      assert(i >= 768 || bloom_may_contain(filter, i) == ONE);
+      false_positives += i >= 768 && bloom_may_contain(filter, i);
+    }
+  assert(false_positives < 10000 / 50);
+  bloom_clear(filter);
+  assert(bloom_may_contain(filter, 5) == ZERO);
+  bloom_free(&filter);
+
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.bloom_filter = ONE;
+  hashmap *hash_map = hashmap_alloc_config(hash_int, &config);
+  char *value = "abc";
+  for (int i = ZERO; i < 1000; i += TWO)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      assert(hashmap_insert(hash_map, new_pair) == ZERO);
+      pair_free((void **) &new_pair);
+    }
+  for (int i = ZERO; i < 1000; i++)
+    {
+      assert((hashmap_at(hash_map, &i) != NULL) == (i % TWO == ZERO));
+    }
+  for (int i = ZERO; i < 900; i++)
+    {
+      assert(hashmap_erase(hash_map, &i) == (i % TWO == ZERO));
+    }
+  for (int i = ZERO; i < 1000; i++)
+    {
+      assert((hashmap_at(hash_map, &i) != NULL)
+             == (i >= 900 && i % TWO == ZERO));
+    }
+  hashmap_stats stats;
+  hashmap_get_stats(hash_map, &stats);
+  assert(stats.bytes_allocated > bloom_bytes(hash_map->filter));
+  hashmap_clear(hash_map);
+  int key = 950;
+  assert(hashmap_at(hash_map, &key) == NULL);
+  hashmap_free(&hash_map);
+}
+
+/**
+ * @param elem int key
+ * @return 1 if the key is odd, 0 else
+ */
+int is_odd_int (const_keyT elem)
+{
+  return *(const int *) elem % TWO == ONE;
+}
+
+/**
+ * leaves the value as is
+ * @param elem
+ */
+void keep_value (valueT elem)
+{
+  (void) elem;
+}
+
+/**
+ * This function checks the cuckoo backend: every key is found in one of its
+ * two buckets, and too many equal full hashes fail the insertion instead of
+ * growing the table forever.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_cuckoo(void)
+{
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.cuckoo = ONE;
+  hashmap *hash_map = hashmap_alloc_config(hash_int, &config);
+  char *value = "abc";
+  for (int i = ZERO; i < 2000; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      assert(hashmap_insert(hash_map, new_pair) == ZERO);
+      pair_free((void **) &new_pair);
+    }
+  assert(hash_map->buckets == NULL && hash_map->size == 2000);
+  assert(hashmap_get_load_factor(hash_map) <= HASH_MAP_MAX_LOAD_FACTOR);
+  hashmap_stats stats;
+  hashmap_get_stats(hash_map, &stats);
+  assert(stats.max_chain <= CUCKOO_BUCKET_SLOTS);
+  for (int i = ZERO; i < 2000; i++)
+    {
+      pair *found = cuckoo_find(hash_map->cuckoo, &i, hash_int(&i),
+                                &stats.key_cmp_calls, NULL);
+      assert(found != NULL && found == cuckoo_find(hash_map->cuckoo, &i,
+                                                   found->hash,
+                                                   &stats.key_cmp_calls,
+                                                   NULL));
+      assert(*(int *) found->key == i);
+    }
+  for (int i = ZERO; i < 2000; i += TWO)
+    {
+      assert(hashmap_erase(hash_map, &i) == ONE);
+      assert(hashmap_erase(hash_map, &i) == ZERO);
+    }
+  for (int i = ZERO; i < 2000; i++)
+    {
+      assert((hashmap_at(hash_map, &i) != NULL) == (i % TWO == ONE));
+    }
+  assert(hashmap_apply_if(hash_map, is_odd_int, keep_value) == 1000);
+  hashmap_free(&hash_map);
+
+  hash_map = hashmap_alloc_config(hash_collide, &config);
+  int inserted = ZERO;
+  for (int i = ZERO; i < 20; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      inserted += hashmap_insert(hash_map, new_pair);
+      pair_free((void **) &new_pair);
+    }
+  assert(inserted == TWO * (int) CUCKOO_BUCKET_SLOTS);
+  assert((int) hash_map->size == inserted);
+  for (int i = ZERO; i < inserted; i++)
+    {
+      assert(hashmap_at(hash_map, &i) != NULL);
+    }
+  hashmap_free(&hash_map);
+}
+
+/**
+ * @param entry pair of int key and string value
+ * @return the length of the value, as the cost of the pair
+ */
+size_t string_value_size (const pair *entry)
+{
+  return strlen(*(char *const *) entry->value);
+}
+
+/**
+ * This function checks LRU hash maps: lookups refresh pairs, and insertions
+ * over the entry count or byte budget evict the least recently used pairs.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_lru(void)
+{
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.max_entries = 10;
+  config.counters = ONE;
+  hashmap *hash_map = hashmap_alloc_config(hash_int, &config);
+  char *value = "abc";
+  for (int i = ZERO; i < 10; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  int zero = ZERO, one = ONE;
+  assert(hashmap_at(hash_map, &zero) != NULL);
+  for (int i = 10; i < 15; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+      assert(hash_map->size == 10);
+    }
+  // 0 was refreshed, so 1..5 were evicted
+  assert(hashmap_at(hash_map, &zero) != NULL);
+  for (int i = ONE; i < 15; i++)
+    {
+      assert((hashmap_at(hash_map, &i) == NULL) == (i <= 5));
+    }
+  assert(*(int *) hash_map->lru->tail->key == zero);
+  // only the pairs of an LRU hash map carry recency links
+  assert(pair_bytes(hash_map->lru->tail) == sizeof(pair) + sizeof(lru_links));
+  assert(hashmap_erase(hash_map, &zero) == ONE);
+  assert(*(int *) hash_map->lru->tail->key == 6);
+  hashmap_stats stats;
+  hashmap_get_stats(hash_map, &stats);
+  assert(stats.evictions == 5);
+  hashmap_clear(hash_map);
+  assert(hash_map->lru->head == NULL && hash_map->lru->tail == NULL);
+  hashmap_free(&hash_map);
+
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.max_bytes = 10;
+  assert(hashmap_alloc_config(hash_int, &config) == NULL);
+  config.entry_size = string_value_size;
+  config.cuckoo = ONE;
+  hash_map = hashmap_alloc_config(hash_int, &config);
+  char *long_value = "abcdefgh";
+  for (int i = ZERO; i < 3; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  assert(hash_map->size == 3 && hash_map->lru->bytes == 9);
+  pair *new_pair = create_pair(&one, &long_value, INT, STRING);
+  assert(hashmap_insert(hash_map, new_pair) == ZERO);
+  pair_free((void **) &new_pair);
+  int three = 3;
+  new_pair = create_pair(&three, &long_value, INT, STRING);
+  assert(hashmap_insert(hash_map, new_pair) == ONE);
+  pair_free((void **) &new_pair);
+  assert(hash_map->size == ONE && hash_map->lru->bytes == 8);
+  assert(hashmap_at(hash_map, &three) != NULL);
+  hashmap_free(&hash_map);
+}
+
+unsigned long long test_now = 1000;
+
+/**
+ * @return the time of the TTL tests
+ */
+unsigned long long test_clock (void)
+{
+  return test_now;
+}
+
+/**
+ * This function checks pairs inserted with a TTL: they are missing once
+ * expired, and hashmap_expire_step reclaims exactly the expired ones, in
+ * steps of at most its budget.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_ttl(void)
+{
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.clock = test_clock;
+  hashmap *hash_map = hashmap_alloc_config(hash_int, &config);
+  char *value = "abc";
+  for (int i = ZERO; i < 110; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      if (i < 100)
+        {
+          assert(hashmap_insert_ttl(hash_map, new_pair, i + ONE) == ONE);
+          assert(hashmap_insert_ttl(hash_map, new_pair, i + ONE) == ZERO);
+        }
+      else
+        {
+          assert(hashmap_insert(hash_map, new_pair) == ONE);
+        }
+      pair_free((void **) &new_pair);
+    }
+  int key = 200;
+  pair *new_pair = create_pair(&key, &value, INT, STRING);
+  assert(hashmap_insert_ttl(hash_map, new_pair, 100000000) == ONE);
+  pair_free((void **) &new_pair);
+  // only the pairs inserted with a TTL carry a timer entry
+  key = 99;
+  pair *entry = (pair *) ((char *) hashmap_at_mut(hash_map, &key)
+                          - offsetof(pair, value));
+  assert(pair_bytes(entry) == sizeof(pair) + sizeof(timer_entry));
+  key = 100;
+  entry = (pair *) ((char *) hashmap_at_mut(hash_map, &key)
+                    - offsetof(pair, value));
+  assert(pair_bytes(entry) == sizeof(pair));
+  test_now = 1050;
+  for (int i = ZERO; i < 110; i++)
+    {
+      assert((hashmap_at(hash_map, &i) == NULL) == (i < 50));
+    }
+  assert(hash_map->size == 111);
+  assert(hashmap_expire_step(hash_map, test_now, 10) == 10);
+  assert(hashmap_expire_step(hash_map, test_now, 1000) == 40);
+  assert(hashmap_expire_step(hash_map, test_now, 1000) == ZERO);
+  assert(hash_map->size == 61);
+
+  test_now = 1060;
+  key = 55;
+  assert(hashmap_at_mut(hash_map, &key) == NULL);
+  assert(hash_map->size == 60);
+  key = 60;
+  new_pair = create_pair(&key, &value, INT, STRING);
+  assert(hashmap_insert(hash_map, new_pair) == ZERO);
+  test_now = 1061;
+  assert(hashmap_insert(hash_map, new_pair) == ONE);
+  pair_free((void **) &new_pair);
+  assert(hashmap_at(hash_map, &key) != NULL);
+  assert(hashmap_expire_step(hash_map, test_now, 1000) == 9);
+  assert(hash_map->size == 51);
+
+  test_now = 10000000;
+  assert(hashmap_expire_step(hash_map, test_now, 1000) == 39);
+  key = 200;
+  assert(hashmap_at(hash_map, &key) != NULL);
+  test_now = 1000 + 100000000;
+  assert(hashmap_expire_step(hash_map, test_now, 1000) == ONE);
+  assert(hash_map->size == 11);
+  key = 300;
+  new_pair = create_pair(&key, &value, INT, STRING);
+  assert(hashmap_insert_ttl(hash_map, new_pair, ULLONG_MAX) == ONE);
+  pair_free((void **) &new_pair);
+  test_now += 1000000;
+  assert(hashmap_expire_step(hash_map, test_now, 1000) == ZERO);
+  assert(hashmap_at(hash_map, &key) != NULL);
+  hashmap_free(&hash_map);
+}
+
+int visited_keys[2000];
+int visited = ZERO;
+
+/**
+ * records the int key it is called with
+ * @param elem int key
+ * @return 1
+ */
+int record_int_key (const_keyT elem)
+{
+  visited_keys[visited++] = *(const int *) elem;
+  return ONE;
+}
+
+/**
+ * records the int value it is called with (an int key of a set)
+ * @param elem int value
+ */
+void record_value_key (valueT elem)
+{
+  visited_keys[visited++] = *(const int *) elem;
+}
+
+/**
+ * This function checks the compact backend: hashmap_apply_if visits the
+ * pairs in insertion order, also after erasures and resizes.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_compact(void)
+{
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.compact = ONE;
+  hashmap *hash_map = hashmap_alloc_config(hash_int, &config);
+  char *value = "abc";
+  for (int i = ZERO; i < 1000; i++)
+    {
+      int key = i * 7 % 1000;
+      pair *new_pair = create_pair(&key, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      assert(hashmap_insert(hash_map, new_pair) == ZERO);
+      pair_free((void **) &new_pair);
+    }
+  assert(hash_map->buckets == NULL && hash_map->size == 1000);
+  assert(hashmap_get_load_factor(hash_map) <= HASH_MAP_MAX_LOAD_FACTOR);
+  for (int i = ZERO; i < 1000; i += TWO)
+    {
+      assert(hashmap_erase(hash_map, &i) == ONE);
+      assert(hashmap_erase(hash_map, &i) == ZERO);
+    }
+  for (int i = 1000; i < 1100; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  assert(hash_map->size == 600);
+  visited = ZERO;
+  assert(hashmap_apply_if(hash_map, record_int_key, keep_value) == 600);
+  int expected = ZERO;
+  for (int i = ZERO; i < 1000; i++)
+    {
+      if (i * 7 % 1000 % TWO == ONE)
+        {
+          assert(visited_keys[expected++] == i * 7 % 1000);
+        }
+    }
+  for (int i = 1000; i < 1100; i++)
+    {
+      assert(visited_keys[expected++] == i);
+    }
+  hashmap_stats stats;
+  hashmap_get_stats(hash_map, &stats);
+  assert(stats.used_buckets == 600 && stats.max_chain >= ONE);
+
+  for (int i = ONE; i < 1000; i += TWO)
+    {
+      assert(hashmap_erase(hash_map, &i) == ONE);
+    }
+  assert(hash_map->size == 100 && hash_map->capacity < 1024);
+  visited = ZERO;
+  assert(hashmap_apply_if(hash_map, record_int_key, keep_value) == 100);
+  for (int i = ZERO; i < 100; i++)
+    {
+      assert(visited_keys[i] == 1000 + i);
+      assert(hashmap_at(hash_map, &visited_keys[i]) != NULL);
+    }
+  hashmap_clear(hash_map);
+  assert(hash_map->size == ZERO);
+  int key = 5;
+  assert(hashmap_at(hash_map, &key) == NULL);
+  hashmap_free(&hash_map);
+}
+
+int range_values[100];
+int range_size = ZERO;
+
+/**
+ * records the int value of a pair
+ * @param key
+ * @param value int value
+ * @param ctx int counting the calls
+ */
+void record_int_value (const_keyT key, valueT value, void *ctx)
+{
+  (void) key;
+  range_values[range_size++] = *(int *) value;
+  (*(int *) ctx)++;
+}
+
+/**
+ * This function checks multimaps: equal keys are all inserted, kept adjacent
+ * in their bucket, and walked in insertion order by hashmap_equal_range.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_multimap(void)
+{
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.multimap = ONE;
+  hashmap *hash_map = hashmap_alloc_config(hash_collide, &config);
+  for (int round = ZERO; round < 6; round++)
+    {
+      for (char key = 'a'; key <= 'e'; key++)
+        {
+          int value = round * 10 + key - 'a';
+          pair *new_pair = create_pair(&key, &value, CHAR, INT);
+          assert(hashmap_insert(hash_map, new_pair) == ONE);
+          pair_free((void **) &new_pair);
+        }
+    }
+  assert(hash_map->size == 30);
+  pair **pairs = bucket_pairs(&hash_map->buckets[ZERO]);
+  int groups = ONE;
+  for (size_t i = ONE; i < bucket_size(&hash_map->buckets[ZERO]); i++)
+    {
+      groups += *(char *) pairs[i]->key != *(char *) pairs[i - ONE]->key;
+    }
+  assert(groups == 5);
+  char key = 'c';
+  int calls = ZERO;
+  range_size = ZERO;
+  assert(hashmap_count(hash_map, &key) == 6);
+  assert(hashmap_equal_range(hash_map, &key, record_int_value, &calls) == 6);
+  assert(calls == 6);
+  for (int i = ZERO; i < 6; i++)
+    {
+      assert(range_values[i] == i * 10 + TWO);
+    }
+  key = 'b';
+  assert(*(int *) hashmap_at(hash_map, &key) == ONE);
+  assert(hashmap_erase(hash_map, &key) == ONE);
+  assert(hashmap_count(hash_map, &key) == 5);
+  assert(*(int *) hashmap_at(hash_map, &key) == 11);
+  key = 'z';
+  assert(hashmap_count(hash_map, &key) == ZERO);
+  assert(hashmap_equal_range(hash_map, &key, record_int_value, &calls) == 0);
+  hashmap_free(&hash_map);
+
+  hash_map = hashmap_alloc_config(hash_char, &config);
+  for (int value = ZERO; value < 100; value++)
+    {
+      key = (char) ('A' + value % 20);
+      pair *new_pair = create_pair(&key, &value, CHAR, INT);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  assert(hash_map->size == 100 && hash_map->capacity > HASH_MAP_INITIAL_CAP);
+  key = 'D';
+  range_size = ZERO;
+  assert(hashmap_equal_range(hash_map, &key, record_int_value, &calls) == 5);
+  for (int i = ZERO; i < 5; i++)
+    {
+      assert(range_values[i] == 3 + i * 20);
+    }
+  while (hashmap_erase(hash_map, &key) == ONE)
+    {
+    }
+  assert(hashmap_count(hash_map, &key) == ZERO && hash_map->size == 95);
+  hashmap_free(&hash_map);
+
+  hash_map = hashmap_alloc(hash_char);
+  key = 'a';
+  int value = ONE;
+  pair *new_pair = create_pair(&key, &value, CHAR, INT);
+  assert(hashmap_insert(hash_map, new_pair) == ONE);
+  assert(hashmap_insert(hash_map, new_pair) == ZERO);
+  pair_free((void **) &new_pair);
+  assert(hashmap_count(hash_map, &key) == ONE);
+  hashmap_free(&hash_map);
+}
+
+/**
+ * adds an int key to a sum
+ * @param key int key
+ * @param ctx the sum
+ */
+void sum_int_key (const_keyT key, void *ctx)
+{
+  *(long *) ctx += *(const int *) key;
+}
+
+/**
+ * @param value
+ * @return a dynamically allocated int holding value
+ */
+int *new_int (int value)
+{
+  int *key = malloc(sizeof(int));
+  assert(key != NULL);
+  *key = value;
+  return key;
+}
+
+/**
+ * checks the set algebra of sets which adopt their keys: the results borrow
+ * the keys, and a present key is left to the caller
+ */
+void check_adopting_sets (void)
+{
+  hashset *a = hashset_alloc(hash_int, NULL, int_key_cmp, int_key_free);
+  hashset *b = hashset_alloc(hash_int, NULL, int_key_cmp, int_key_free);
+  for (int i = ZERO; i < 15; i++)
+    {
+      assert(hashset_insert(a, new_int(i)) == ONE);
+      assert(hashset_insert(b, new_int(i + 10)) == ONE);
+    }
+  int *present = new_int(3);
+  assert(hashset_insert(a, present) == ZERO && *present == 3);
+  free(present);
+  hashset *sets[] = {hashset_union(a, b), hashset_intersection(a, b),
+                     hashset_difference(a, b), hashset_difference(b, a)};
+  size_t sizes[] = {25, 5, 10, 10};
+  long sums[] = {300, 60, 45, 195};
+  for (size_t i = ZERO; i < 4; i++)
+    {
+      long sum = ZERO;
+      assert(hashset_foreach(sets[i], sum_int_key, &sum) == sizes[i]);
+      assert(sum == sums[i]);
+      hashset_free(&sets[i]);
+    }
+  hashset_free(&a);
+  hashset_free(&b);
+
+  // a union takes the funcs of a: it copies the keys of a larger b which
+  // borrows them, so it outlives them
+  a = hashset_alloc(hash_int, int_key_cpy, int_key_cmp, int_key_free);
+  b = hashset_alloc(hash_int, NULL, int_key_cmp, NULL);
+  int *keys[20];
+  for (int i = ZERO; i < 20; i++)
+    {
+      keys[i] = new_int(i);
+      assert(hashset_insert(b, keys[i]) == ONE);
+    }
+  int key = 30;
+  assert(hashset_insert(a, &key) == ONE);
+  hashset *both = hashset_union(a, b);
+  hashset_free(&b);
+  for (int i = ZERO; i < 20; i++)
+    {
+      free(keys[i]);
+    }
+  long sum = ZERO;
+  assert(hashset_foreach(both, sum_int_key, &sum) == 21 && sum == 220);
+  key = 19;
+  assert(hashset_contains(both, &key));
+  hashset_free(&both);
+  hashset_free(&a);
+}
+
+/**
+ * This function checks hash sets: insertions of present keys fail, and the
+ * set algebra gives the same keys whichever operand is smaller.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_set(void)
+{
+  hashset *a = hashset_alloc(hash_int, int_key_cpy, int_key_cmp, int_key_free);
+  hashset *b = hashset_alloc(hash_int, int_key_cpy, int_key_cmp, int_key_free);
+  for (int i = ZERO; i < 100; i++)
+    {
+      assert(hashset_insert(a, &i) == ONE);
+      assert(hashset_insert(a, &i) == ZERO);
+    }
+  for (int i = 50; i < 250; i++)
+    {
+      assert(hashset_insert(b, &i) == ONE);
+    }
+  assert(hashset_size(a) == 100 && hashset_size(b) == 200);
+  int key = 99;
+  assert(hashset_contains(a, &key) && hashset_contains(b, &key));
+  assert(*(int *) hashmap_at(a->map, &key) == 99);
+  key = 100;
+  assert(!hashset_contains(a, &key) && hashset_contains(b, &key));
+
+  hashset *sets[] = {hashset_union(a, b), hashset_union(b, a),
+                     hashset_intersection(a, b), hashset_intersection(b, a),
+                     hashset_difference(a, b), hashset_difference(b, a)};
+  size_t sizes[] = {250, 250, 50, 50, 50, 150};
+  long sums[] = {31125, 31125, 3725, 3725, 1225, 26175};
+  for (size_t i = ZERO; i < 6; i++)
+    {
+      long sum = ZERO;
+      assert(hashset_size(sets[i]) == sizes[i]);
+      assert(hashset_foreach(sets[i], sum_int_key, &sum) == sizes[i]);
+      assert(sum == sums[i]);
+      hashset_free(&sets[i]);
+    }
+  key = 10;
+  assert(hashset_erase(a, &key) == ONE && hashset_erase(a, &key) == ZERO);
+  assert(!hashset_contains(a, &key) && hashset_size(a) == 99);
+  hashset_free(&a);
+  hashset_free(&b);
+  assert(a == NULL);
+
+  static int borrowed[] = {3, 1, 4, 1, 5};
+  hashset *c = hashset_alloc(hash_int, NULL, int_key_cmp, NULL);
+  for (size_t i = ZERO; i < 5; i++)
+    {
+      hashset_insert(c, &borrowed[i]);
+    }
+  assert(hashset_size(c) == 4);
+  // the keys of a set are key-only pairs, allocated without a value
+  // whose keys are not handed out to be replaced
+  assert(hashmap_at_mut(c->map, &borrowed[ZERO]) == NULL);
+  pair *entry = NULL;
+  for (size_t i = ZERO; entry == NULL; i++)
+    {
+      if (bucket_size(&c->map->buckets[i]) > ZERO)
+        {
+          entry = bucket_pairs(&c->map->buckets[i])[ZERO];
+        }
+    }
+  assert(hashmap_at(c->map, entry->key) == entry->key);
+  assert(pair_value(entry) == entry->key);
+  assert(pair_bytes(entry) == offsetof(pair, value));
+  // the values visited in a set are its keys
+  visited = ZERO;
+  assert(hashmap_apply_if(c->map, record_int_key, record_value_key) == 4);
+  for (int i = ZERO; i < 8; i += 2)
+    {
+      assert(visited_keys[i] == visited_keys[i + ONE]);
+    }
+  hashset_free(&c);
+
+  pair_type key_only = {NULL, NULL, int_key_cmp, NULL, NULL, NULL,
+                        sizeof(int), ZERO, ZERO, ONE, NULL};
+  key = 7;
+  entry = pair_alloc_type(&key, NULL, &key_only);
+  assert(*(int *) entry->key == 7 && pair_value(entry) == entry->key);
+  assert(pair_bytes(entry) == offsetof(pair, value) + sizeof(int));
+  pair *copy = pair_copy(entry);
+  assert(pair_cmp(copy, entry) == ONE);
+  pair *full = pair_alloc_inline(&key, &key, sizeof(int), sizeof(int),
+                                 int_key_cmp, int_value_cmp);
+  assert(pair_cmp(full, entry) == ZERO && pair_cmp(entry, full) == ZERO);
+  pair_free((void **) &full);
+  assert(pair_bytes(copy) == offsetof(pair, value) + sizeof(pair_type)
+                             + sizeof(int));
+  pair_free((void **) &copy);
+  pair_free((void **) &entry);
+  check_adopting_sets();
+}
+
+size_t hash_calls = ZERO;
+
+/**
+ * hash_char, counting its calls
+ * @param elem char key
+ * @return the hash of the key
+ */
+size_t counting_hash_char (const_keyT elem)
+{
+  hash_calls++;
+  return hash_char(elem);
+}
+
+/**
+ * adds an int value to another, in place
+ * @param value int value to be changed
+ * @param other int value
+ */
+void add_int_value (valueT value, const_valueT other)
+{
+  *(int *) value += *(const int *) other;
+}
+
+/**
+ * fills a char to int hash map with the keys in [first, last]
+ * @param hash_map
+ * @param first, last
+ * @param value the value of all the keys
+ */
+void fill_char_int (hashmap *hash_map, char first, char last, int value)
+{
+  for (char key = first; key <= last; key++)
+    {
+      pair *new_pair = create_pair(&key, &value, CHAR, INT);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+}
+
+/**
+ * This function checks hashmap_merge and hashmap_intersect: conflicts are
+ * merged, the destination grows once, and cached hashes are reused between
+ * hash maps which hash keys the same way.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_merge(void)
+{
+  hashmap *a = hashmap_alloc(counting_hash_char);
+  hashmap *b = hashmap_alloc(counting_hash_char);
+  fill_char_int(a, 'a', 'z', ONE);
+  fill_char_int(b, 'n', 'z', 10);
+  fill_char_int(b, 'A', 'Z', 10);
+  hashmap *out = hashmap_alloc(counting_hash_char);
+  hash_calls = ZERO;
+  assert(hashmap_intersect(a, b, out) == ONE);
+  assert(hash_calls == ZERO && out->size == 13);
+  char key = 'q';
+  assert(*(int *) hashmap_at(out, &key) == ONE);
+  key = 'm';
+  assert(hashmap_at(out, &key) == NULL);
+  hashmap_free(&out);
+  out = hashmap_alloc(counting_hash_char);
+  assert(hashmap_intersect(b, a, out) == ONE && out->size == 13);
+  key = 'q';
+  assert(*(int *) hashmap_at(out, &key) == 10);
+  hashmap_free(&out);
+
+  size_t capacity = a->capacity;
+  hash_calls = ZERO;
+  assert(hashmap_merge(a, b, add_int_value) == ONE);
+  assert(hash_calls == ZERO
+         && a->capacity <= capacity * HASH_MAP_GROWTH_FACTOR);
+  assert(a->size == 52);
+  key = 'q';
+  assert(*(int *) hashmap_at(a, &key) == 11);
+  key = 'b';
+  assert(*(int *) hashmap_at(a, &key) == ONE);
+  key = 'B';
+  assert(*(int *) hashmap_at(a, &key) == 10);
+  assert(hashmap_merge(a, a, NULL) == ZERO);
+
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.mix_hash = ONE;
+  hashmap *mixed = hashmap_alloc_config(counting_hash_char, &config);
+  hash_calls = ZERO;
+  assert(hashmap_merge(mixed, b, NULL) == ONE);
+  assert(hash_calls == b->size && mixed->size == b->size);
+  key = 'Z';
+  assert(*(int *) hashmap_at(mixed, &key) == 10);
+  hashmap_free(&mixed);
+  hashmap_free(&a);
+  hashmap_free(&b);
+
+  // the expired pairs of dst are dropped without shrinking it mid-merge
+  config.mix_hash = ZERO;
+  config.clock = test_clock;
+  config.counters = ONE;
+  a = hashmap_alloc_config(hash_int, &config);
+  b = hashmap_alloc(hash_int);
+  char *value = "abc";
+  test_now = 1000;
+  for (int i = ZERO; i < 100; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert_ttl(a, new_pair, ONE) == ONE);
+      assert(hashmap_insert(b, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  test_now = 2000;
+  hashmap_stats stats;
+  hashmap_get_stats(a, &stats);
+  size_t shrinks = stats.shrinks;
+  capacity = a->capacity;
+  assert(hashmap_merge(a, b, NULL) == ONE);
+  hashmap_get_stats(a, &stats);
+  assert(stats.shrinks == shrinks && a->capacity >= capacity);
+  assert(a->size == 100);
+  for (int i = ZERO; i < 100; i++)
+    {
+      assert(hashmap_at(a, &i) != NULL);
+    }
+  hashmap_free(&a);
+  hashmap_free(&b);
+}
+
+/**
+ * This function checks hashmap_from_arrays: the buckets are sized for the
+ * pairs up front, and colliding keys are spilled and sorted as if inserted.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_hash_map_from_arrays(void)
+{
+  int keys[1000];
+  char *value = "abc";
+  const_keyT key_ptrs[1000];
+  const_valueT value_ptrs[1000];
+  for (int i = ZERO; i < 1000; i++)
+    {
+      keys[i] = i;
+      key_ptrs[i] = &keys[i];
+      value_ptrs[i] = &value;
+    }
+  int zero = ZERO;
+  pair *type = create_pair(&zero, &value, INT, STRING);
+  hashmap *hash_map = hashmap_from_arrays(hash_int, key_ptrs, value_ptrs,
+                                          1000, type);
+  assert(hash_map->size == 1000 && hash_map->capacity == 2048);
+  assert(hash_map->counters == NULL);
+  for (int i = ZERO; i < 1000; i++)
+    {
+      assert(strcmp(*(char **) hashmap_at(hash_map, &i), "abc") == ZERO);
+    }
+  assert(hashmap_insert(hash_map, type) == ZERO);
+  hashmap_free(&hash_map);
+
+  hash_map = hashmap_from_arrays(hash_collide, key_ptrs, value_ptrs, 50,
+                                 type);
+  assert(hash_map->size == 50 && bucket_size(&hash_map->buckets[ZERO]) == 50);
+  for (int i = ZERO; i < 50; i++)
+    {
+      assert(hashmap_at(hash_map, &i) != NULL);
+      assert(hashmap_erase(hash_map, &i) == ONE);
+    }
+  assert(hash_map->size == ZERO);
+  hashmap_free(&hash_map);
+
+  hash_map = hashmap_from_arrays(hash_int, NULL, NULL, ZERO, type);
+  assert(hash_map->size == ZERO && hash_map->capacity == HASH_MAP_INITIAL_CAP);
+  hashmap_free(&hash_map);
+  key_ptrs[10] = NULL;
+  assert(hashmap_from_arrays(hash_int, key_ptrs, value_ptrs, 20, type)
+         == NULL);
+  pair_free((void **) &type);
+}
+
+/**
+ * This function checks disk maps: pairs survive page splits and evictions
+ * from a small page cache, and duplicates are rejected.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_diskmap(void)
+{
+  diskmap *map = diskmap_alloc(NULL, hash_int, sizeof(int), sizeof(long), 4);
+  assert(map != NULL);
+  for (int i = ZERO; i < 20000; i++)
+    {
+      long value = (long) i * i;
+      assert(diskmap_insert(map, &i, &value) == ONE);
+    }
+  int key = 77;
+  long value = ZERO;
+  assert(diskmap_insert(map, &key, &value) == ZERO);
+  assert(map->size == 20000 && map->page_count > 4);
+  assert(map->page_writes > ZERO);
+  for (int i = ZERO; i < 20000; i++)
+    {
+      assert(diskmap_at(map, &i, &value) == ONE && value == (long) i * i);
+    }
+  assert(map->page_reads > ZERO);
+  for (int i = ONE; i < 20000; i += TWO)
+    {
+      assert(diskmap_erase(map, &i) == ONE);
+      assert(diskmap_erase(map, &i) == ZERO);
+    }
+  for (int i = ZERO; i < 20000; i++)
+    {
+      assert(diskmap_at(map, &i, NULL) == (i % TWO == ZERO));
+    }
+  key = 20001;
+  assert(diskmap_at(map, &key, &value) == ZERO);
+  assert(map->size == 10000 && diskmap_flush(map) == ONE);
+  diskmap_free(&map);
+  assert(map == NULL);
+  assert(diskmap_alloc(NULL, hash_int, sizeof(int), sizeof(long), ONE)
+         == NULL);
+  assert(diskmap_alloc(NULL, hash_int, DISKMAP_PAGE_SIZE, ONE, 4) == NULL);
+}
+
+/**
+ * the bookkeeping of a counting allocator
+ */
+typedef struct counting_allocator {
+    size_t live_bytes;
+    size_t allocations;
+} counting_allocator;
+
+/**
+ * allocates with calloc and counts the live bytes
+ * @param ctx counting_allocator
+ * @param size
+ * @return the memory
+ */
+void *counting_allocate (void *ctx, size_t size)
+{
+  counting_allocator *counter = (counting_allocator *) ctx;
+  counter->live_bytes += size;
+  counter->allocations++;
+  return calloc(ONE, size);
+}
+
+/**
+ * frees with free and counts the live bytes
+ * @param ctx counting_allocator
+ * @param memory
+ * @param size the size memory was allocated with
+ */
+void counting_deallocate (void *ctx, void *memory, size_t size)
+{
+  counting_allocator *counter = (counting_allocator *) ctx;
+  assert(counter->live_bytes >= size);
+  counter->live_bytes -= size;
+  free(memory);
+}
+
+/**
+ * This function checks hash maps with an allocator: a counting allocator
+ * gets back exactly what it gave, with every backend, and the huge page
+ * allocator holds a bucket array of megabytes, aligned to a huge page.
+ * If the hash map fails at some points, the functions exits with exit code 1.
+ */
+void test_allocator(void)
+{
+  counting_allocator counter = {ZERO, ZERO};
+  hashmap_allocator allocator = {counting_allocate, counting_deallocate,
+                                 &counter};
+  hashmap_config config;
+  memset(&config, ZERO, sizeof(hashmap_config));
+  config.allocator = &allocator;
+  hashmap *hash_map = hashmap_alloc_config(hash_int, &config);
+  assert(hash_map != NULL && counter.live_bytes > ZERO);
+  char *value = "abc";
+  for (int i = ZERO; i < 1000; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  // the pairs (and spill arrays) come from the allocator too
+  assert(counter.live_bytes >= hash_map->capacity * sizeof(bucket)
+                               + 1000 * sizeof(pair));
+  int key = 1000;
+  pair *owned = pair_alloc(&key, &value, NULL, NULL, int_key_cmp,
+                           char_value_cmp, NULL, NULL);
+  size_t live_bytes = counter.live_bytes;
+  assert(hashmap_insert_owned(hash_map, owned) == ONE);
+  assert(counter.live_bytes > live_bytes);
+  for (int i = ZERO; i <= 1000; i++)
+    {
+      assert(hashmap_erase(hash_map, &i) == ONE);
+    }
+  assert(hash_map->capacity < 1000);
+  hashmap_free(&hash_map);
+  assert(counter.live_bytes == ZERO && counter.allocations > 1000);
+
+  // so do the tables of the cuckoo and compact backends and the filter
+  for (int backend = ZERO; backend < 3; backend++)
+    {
+      config.cuckoo = backend == ZERO;
+      config.compact = backend == ONE;
+      config.bloom_filter = backend == 2;
+      hash_map = hashmap_alloc_config(hash_int, &config);
+      assert(counter.live_bytes > sizeof(hashmap)
+                                  + (backend == 2 ? HASH_MAP_INITIAL_CAP
+                                                    * sizeof(bucket) : ZERO));
+      for (int i = ZERO; i < 1000; i++)
+        {
+          pair *new_pair = create_pair(&i, &value, INT, STRING);
+          assert(hashmap_insert(hash_map, new_pair) == ONE);
+          pair_free((void **) &new_pair);
+        }
+      hashmap_free(&hash_map);
+      assert(counter.live_bytes == ZERO);
+    }
+  config.cuckoo = ZERO;
+  config.compact = ZERO;
+  config.bloom_filter = ZERO;
+
+  allocator.deallocate = NULL;
+  assert(hashmap_alloc_config(hash_int, &config) == NULL);
+
+  allocator = allocator_huge_pages();
+  hash_map = hashmap_alloc_config(hash_int, &config);
+  for (int i = ZERO; i < 100000; i++)
+    {
+      pair *new_pair = create_pair(&i, &value, INT, STRING);
+      assert(hashmap_insert(hash_map, new_pair) == ONE);
+      pair_free((void **) &new_pair);
+    }
+  assert(hash_map->capacity * sizeof(bucket) >= ALLOCATOR_HUGE_PAGE_SIZE);
+  // the huge page advice covers the whole array
+  assert((uintptr_t) hash_map->buckets % ALLOCATOR_HUGE_PAGE_SIZE == ZERO);
+  for (int i = ZERO; i < 100000; i++)
+    {
+      assert(hashmap_at(hash_map, &i) != NULL);
+    }
+  hashmap_clear(hash_map);
+  assert(hash_map->size == ZERO);
+  hashmap_free(&hash_map);
+}
@@ -0,0 +1,40 @@
+#ifndef TEST_SUITE_H_
+#define TEST_SUITE_H_
+
+#include <assert.h>
+#include <string.h>
+#include "hashmap.h"
+
+/**
+ * The tests of the hashmap library. Each test checks one part of the library
+ * and asserts on its results, so a failing test aborts the program; a test
+ * that returns has passed.
+ */
+void test_hash_map_insert (void);
+void test_hash_map_at (void);
+void test_hash_map_erase (void);
+void test_hash_map_get_load_factor (void);
+void test_hash_map_apply_if (void);
+void test_typed_hash_map (void);
+void test_hash_map_inline_pairs (void);
+void test_hash_map_get_stats (void);
+void test_hash_map_mix_hash (void);
+void test_hash_map_keyed_hash (void);
+void test_hash_map_treeify (void);
+void test_vector_bulk (void);
+void test_hash_map_clear (void);
+void test_hash_map_insert_owned (void);
+void test_hash_map_at_mut (void);
+void test_hash_map_bloom_filter (void);
+void test_hash_map_cuckoo (void);
+void test_hash_map_lru (void);
+void test_hash_map_ttl (void);
+void test_hash_map_compact (void);
+void test_hash_map_multimap (void);
+void test_hash_set (void);
+void test_hash_map_merge (void);
+void test_hash_map_from_arrays (void);
+void test_diskmap (void);
+void test_allocator (void);
+
+#endif //TEST_SUITE_H_
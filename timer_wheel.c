@@ -0,0 +1,185 @@
+#include <string.h>
+#include "timer_wheel.h"
+
+#define ZERO 0
+#define ONE 1
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - ONE)
+
+/**
+ * Allocates dynamically an empty timer wheel.
+ * @param now the current tick.
+ * @return pointer to dynamically allocated wheel, NULL upon failure.
+ */
+timer_wheel *timer_wheel_alloc (unsigned long long now)
+{
+  timer_wheel *wheel = (timer_wheel *) calloc (ONE, sizeof (timer_wheel));
+  if (wheel == NULL)
+    {
+      return NULL;
+    }
+  wheel->now = now;
+  return wheel;
+}
+
+/**
+ * Frees a timer wheel (not the entries in it).
+ * @param p_wheel pointer to dynamically allocated pointer to wheel.
+ */
+void timer_wheel_free (timer_wheel **p_wheel)
+{
+  if (p_wheel == NULL || *p_wheel == NULL)
+    {
+      return;
+    }
+  free (*p_wheel);
+  *p_wheel = NULL;
+}
+
+/**
+ * Removes all the entries from a wheel (without freeing them).
+ * @param wheel
+ */
+void timer_wheel_clear (timer_wheel *wheel)
+{
+  memset (wheel->slots, ZERO, sizeof (wheel->slots));
+  memset (wheel->level_sizes, ZERO, sizeof (wheel->level_sizes));
+  wheel->size = ZERO;
+}
+
+/**
+ * @return the number of ticks a whole level spans
+ */
+unsigned long long timer_wheel_span (size_t level)
+{
+  return 1ULL << (TIMER_WHEEL_BITS * (level + ONE));
+}
+
+/**
+ * Adds an entry to the wheel by its expires time. An entry which already
+ * expired is due on the next timer_wheel_next_expired.
+ * @param wheel
+ * @param entry an unlinked entry, with expires set.
+ */
+void timer_wheel_add (timer_wheel *wheel, timer_entry *entry)
+{
+  unsigned long long expires = entry->expires > wheel->now ? entry->expires
+                                                           : wheel->now;
+  size_t level = ZERO;
+  while (level < TIMER_WHEEL_LEVELS - ONE
+         && expires - wheel->now >= timer_wheel_span (level))
+    {
+      level++;
+    }
+  if (expires - wheel->now >= timer_wheel_span (level))
+    {
+      // out of range, wait in the last slot in range
+      expires = wheel->now + timer_wheel_span (level) - ONE;
+    }
+  size_t slot = (size_t) (expires >> (TIMER_WHEEL_BITS * level))
+                & TIMER_WHEEL_MASK;
+  timer_entry **head = &wheel->slots[level][slot];
+  entry->slot = (unsigned short) (level * TIMER_WHEEL_SLOTS + slot);
+  entry->prev = NULL;
+  entry->next = *head;
+  if (*head != NULL)
+    {
+      (*head)->prev = entry;
+    }
+  *head = entry;
+  wheel->level_sizes[level]++;
+  wheel->size++;
+}
+
+/**
+ * Removes an entry from the wheel.
+ * @param wheel
+ * @param entry an entry added to wheel.
+ */
+void timer_wheel_remove (timer_wheel *wheel, timer_entry *entry)
+{
+  size_t level = entry->slot / TIMER_WHEEL_SLOTS;
+  size_t slot = entry->slot % TIMER_WHEEL_SLOTS;
+  if (entry->prev != NULL)
+    {
+      entry->prev->next = entry->next;
+    }
+  else
+    {
+      wheel->slots[level][slot] = entry->next;
+    }
+  if (entry->next != NULL)
+    {
+      entry->next->prev = entry->prev;
+    }
+  entry->prev = NULL;
+  entry->next = NULL;
+  wheel->level_sizes[level]--;
+  wheel->size--;
+}
+
+/**
+ * moves the entries of the current slot of a level to the lower levels
+ * @param wheel
+ * @param level
+ */
+void timer_wheel_cascade (timer_wheel *wheel, size_t level)
+{
+  size_t slot = (size_t) (wheel->now >> (TIMER_WHEEL_BITS * level))
+                & TIMER_WHEEL_MASK;
+  timer_entry *entry = wheel->slots[level][slot];
+  while (entry != NULL)
+    {
+      timer_entry *next = entry->next;
+      timer_wheel_remove (wheel, entry);
+      timer_wheel_add (wheel, entry);
+      entry = next;
+    }
+}
+
+/**
+ * Advances the wheel towards now, until an entry which expired by now is
+ * found. The entry stays in the wheel until it is removed.
+ * @param wheel
+ * @param now the current tick.
+ * @return an entry whose expires time is not after now, NULL if there is
+ * none.
+ */
+timer_entry *timer_wheel_next_expired (timer_wheel *wheel,
+                                       unsigned long long now)
+{
+  while (ONE)
+    {
+      timer_entry *due = wheel->slots[ZERO][wheel->now & TIMER_WHEEL_MASK];
+      if (due != NULL || wheel->now >= now)
+        {
+          return wheel->now <= now ? due : NULL;
+        }
+      // skip the ticks of empty levels at once, up to the next cascade
+      size_t level = ZERO;
+      while (level < TIMER_WHEEL_LEVELS && wheel->level_sizes[level] == ZERO)
+        {
+          level++;
+        }
+      if (level == TIMER_WHEEL_LEVELS)
+        {
+          wheel->now = now;
+          return NULL;
+        }
+      unsigned long long step = level == ZERO ? ONE
+                                              : timer_wheel_span (level - ONE);
+      unsigned long long next = (wheel->now | (step - ONE)) + ONE;
+      if (next > now)
+        {
+          wheel->now = now;
+          return NULL;
+        }
+      wheel->now = next;
+      for (size_t i = TIMER_WHEEL_LEVELS - ONE; i > ZERO; i--)
+        {
+          if ((wheel->now & (timer_wheel_span (i - ONE) - ONE)) == ZERO)
+            {
+              timer_wheel_cascade (wheel, i);
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdlib.h>
+
+/**
+ * @def TIMER_WHEEL_LEVELS, TIMER_WHEEL_BITS, TIMER_WHEEL_SLOTS
+ * The wheel has TIMER_WHEEL_LEVELS levels of TIMER_WHEEL_SLOTS slots. A slot
+ * of level l spans 2^(TIMER_WHEEL_BITS * l) ticks, so the wheel covers
+ * 2^(TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS) ticks ahead, and entries
+ * expiring later wait in the last level until they come into range.
+ */
+#define TIMER_WHEEL_LEVELS 4UL
+#define TIMER_WHEEL_BITS 6UL
+#define TIMER_WHEEL_SLOTS (1UL << TIMER_WHEEL_BITS)
+
+/**
+ * @struct timer_entry - an entry of a timer wheel, embedded in whatever
+ * expires (e.g. stored right before a pair of a hash map).
+ * @param expires the time the entry expires at.
+ * @param prev, next links of the entry in its slot.
+ * @param slot the level and slot of the entry.
+ */
+typedef struct timer_entry {
+    unsigned long long expires;
+    struct timer_entry *prev;
+    struct timer_entry *next;
+    unsigned short slot;
+} timer_entry;
+
+/**
+ * @struct timer_wheel - hierarchical timer wheel of entries by their expires
+ * time. The slots are lists linked through the entries' prev and next.
+ * @param slots the head of every slot of every level.
+ * @param level_sizes the number of entries in every level.
+ * @param now the tick the wheel has been advanced to.
+ * @param size the number of entries in the wheel.
+ */
+typedef struct timer_wheel {
+    timer_entry *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    size_t level_sizes[TIMER_WHEEL_LEVELS];
+    unsigned long long now;
+    size_t size;
+} timer_wheel;
+
+/**
+ * Allocates dynamically an empty timer wheel.
+ * @param now the current tick.
+ * @return pointer to dynamically allocated wheel, NULL upon failure.
+ */
+timer_wheel *timer_wheel_alloc (unsigned long long now);
+
+/**
+ * Frees a timer wheel (not the entries in it).
+ * @param p_wheel pointer to dynamically allocated pointer to wheel.
+ */
+void timer_wheel_free (timer_wheel **p_wheel);
+
+/**
+ * Removes all the entries from a wheel (without freeing them).
+ * @param wheel
+ */
+void timer_wheel_clear (timer_wheel *wheel);
+
+/**
+ * Adds an entry to the wheel by its expires time. An entry which already
+ * expired is due on the next timer_wheel_next_expired.
+ * @param wheel
+ * @param entry an unlinked entry, with expires set.
+ */
+void timer_wheel_add (timer_wheel *wheel, timer_entry *entry);
+
+/**
+ * Removes an entry from the wheel.
+ * @param wheel
+ * @param entry an entry added to wheel.
+ */
+void timer_wheel_remove (timer_wheel *wheel, timer_entry *entry);
+
+/**
+ * Advances the wheel towards now, until an entry which expired by now is
+ * found. The entry stays in the wheel until it is removed.
+ * @param wheel
+ * @param now the current tick.
+ * @return an entry whose expires time is not after now, NULL if there is
+ * none.
+ */
+timer_entry *timer_wheel_next_expired (timer_wheel *wheel,
+                                       unsigned long long now);
+
+#endif //TIMER_WHEEL_H_
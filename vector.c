@@ -100,6 +100,55 @@ int vector_find (const vector *vector, const void *value)
   return NEGATIVE;
 }
 
+/**
+ * reallocates the data of the vector to a new capacity
+ * @param vector a pointer to vector.
+ * @param capacity the new capacity, at least the size of the vector.
+ * @return 1 upon success 0 upon failure (the vector is left untouched).
+ */
+int vector_set_capacity (vector *vector, size_t capacity)
+{
+  void **temp = (void **) realloc (vector->data, capacity * sizeof (void *));
+  if (temp == NULL)
+    {
+      return FAIL;
+    }
+  vector->data = temp;
+  vector->capacity = capacity;
+  return SUCCESS;
+}
+
+/**
+ * @param size number of elements.
+ * @return the smallest capacity holding size elements within
+ * VECTOR_MAX_LOAD_FACTOR.
+ */
+size_t vector_fit_capacity (size_t size)
+{
+  return (size_t) (size / VECTOR_MAX_LOAD_FACTOR) + ONE;
+}
+
+/**
+ * grows the vector (by VECTOR_GROWTH_FACTOR steps) until it can hold size
+ * elements
+ * @param vector a pointer to vector.
+ * @param size the number of elements the vector should hold.
+ * @return 1 upon success 0 upon failure (the vector is left untouched).
+ */
+int vector_grow (vector *vector, size_t size)
+{
+  size_t capacity = vector->capacity;
+  while ((double) size / capacity > VECTOR_MAX_LOAD_FACTOR)
+    {
+      capacity *= VECTOR_GROWTH_FACTOR;
+    }
+  if (capacity == vector->capacity)
+    {
+      return SUCCESS;
+    }
+  return vector_set_capacity (vector, capacity);
+}
+
 /**
  * Adds a new value to the back (index vector_size) of the vector.
  * @param vector a pointer to vector.
@@ -112,26 +161,125 @@ int vector_push_back (vector *vector, const void *value)
     {
       return FAIL;
     }
-  vector->data[vector->size] = vector->elem_copy_func (value);
+  if (vector_grow (vector, vector->size + ONE) == FAIL)
+    {
+      return FAIL;
+    }
+  void *copy = vector->elem_copy_func (value);
+  if (copy == NULL)
+    {
+      return FAIL;
+    }
+  vector->data[vector->size] = copy;
   vector->size++;
-  if (vector_get_load_factor (vector) > VECTOR_MAX_LOAD_FACTOR)
+  return SUCCESS;
+}
+
+/**
+ * Adds n new values to the back of the vector, growing it at most once.
+ * @param vector a pointer to vector.
+ * @param values the values to be added (copied) to the vector.
+ * @param n the number of values.
+ * @return 1 if all the values were added, 0 otherwise (then none of them is
+ * added).
+ */
+int vector_push_back_many (vector *vector, const void *const *values,
+                           size_t n)
+{
+  if (vector == NULL || (values == NULL && n > ZERO))
     {
-      void **temp = (void **) realloc (vector->data,
-                                       (vector->capacity
-                                        * VECTOR_GROWTH_FACTOR) * sizeof
-                                           (void *));
-      if (temp == NULL)
+      return FAIL;
+    }
+  if (vector_grow (vector, vector->size + n) == FAIL)
+    {
+      return FAIL;
+    }
+  size_t i = ZERO;
+  for (; i < n; i++)
+    {
+      void *copy = values[i] != NULL ? vector->elem_copy_func (values[i])
+                                     : NULL;
+      if (copy == NULL)
         {
-          vector->elem_free_func (&(vector->data[vector->size]));
-          vector->size--;
-          return FAIL;
+          break;
         }
-      vector->data = temp;
-      vector->capacity *= VECTOR_GROWTH_FACTOR;
+      vector->data[vector->size + i] = copy;
+    }
+  if (i < n)
+    {
+      while (i > ZERO)
+        {
+          vector->elem_free_func (&(vector->data[vector->size + --i]));
+        }
+      return FAIL;
     }
+  vector->size += n;
   return SUCCESS;
 }
 
+/**
+ * Adds a value to the back of the vector without copying it. The vector
+ * takes ownership of value, and frees it with elem_free_func.
+ * @param vector a pointer to vector.
+ * @param value dynamically allocated value to be adopted by the vector.
+ * @return 1 if the adding has been done successfully, 0 otherwise (then the
+ * caller still owns value).
+ */
+int vector_emplace_owned (vector *vector, void *value)
+{
+  if (vector == NULL || value == NULL)
+    {
+      return FAIL;
+    }
+  if (vector_grow (vector, vector->size + ONE) == FAIL)
+    {
+      return FAIL;
+    }
+  vector->data[vector->size] = value;
+  vector->size++;
+  return SUCCESS;
+}
+
+/**
+ * Makes sure the vector can hold size elements without growing.
+ * @param vector a pointer to vector.
+ * @param size the number of elements.
+ * @return 1 upon success, 0 otherwise.
+ */
+int vector_reserve (vector *vector, size_t size)
+{
+  if (vector == NULL)
+    {
+      return FAIL;
+    }
+  size_t capacity = vector_fit_capacity (size);
+  if (capacity <= vector->capacity)
+    {
+      return SUCCESS;
+    }
+  return vector_set_capacity (vector, capacity);
+}
+
+/**
+ * Shrinks the capacity of the vector to the smallest one holding its
+ * elements.
+ * @param vector a pointer to vector.
+ * @return 1 upon success, 0 otherwise.
+ */
+int vector_shrink_to_fit (vector *vector)
+{
+  if (vector == NULL)
+    {
+      return FAIL;
+    }
+  size_t capacity = vector_fit_capacity (vector->size);
+  if (capacity >= vector->capacity)
+    {
+      return SUCCESS;
+    }
+  return vector_set_capacity (vector, capacity);
+}
+
 /**
  * This function returns the load factor of the vector.
  * @param vector a vector.
@@ -185,7 +333,28 @@ int vector_erase (vector *vector, size_t ind)
 }
 
 /**
- * Deletes all the elements in the vector.
+ * Removes the element at the given index from the vector by moving the last
+ * element into its place. Unlike vector_erase, it does not keep the order of
+ * the remaining elements and never shrinks the vector, so it takes O(1).
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int vector_erase_unordered (vector *vector, size_t ind)
+{
+  if (vector == NULL || ind >= vector->size)
+    {
+      return FAIL;
+    }
+  vector->elem_free_func (&(vector->data[ind]));
+  vector->size--;
+  vector->data[ind] = vector->data[vector->size];
+  vector->data[vector->size] = NULL;
+  return SUCCESS;
+}
+
+/**
+ * Deletes all the elements in the vector, keeping its capacity.
  * @param vector vector a pointer to vector.
  */
 void vector_clear (vector *vector)
@@ -194,9 +363,10 @@ void vector_clear (vector *vector)
     {
       return;
     }
-  for (int i = (int) vector->size; i >= ONE; i--)
+  for (size_t i = ZERO; i < vector->size; i++)
     {
-      vector_erase (vector, i - ONE);
+      vector->elem_free_func (&(vector->data[i]));
     }
+  vector->size = ZERO;
 }
 
@@ -115,6 +115,42 @@ int vector_find(const vector *vector, const void *value);
  */
 int vector_push_back(vector *vector, const void *value);
 
+/**
+ * Adds n new values to the back of the vector, growing it at most once.
+ * @param vector a pointer to vector.
+ * @param values the values to be added (copied) to the vector.
+ * @param n the number of values.
+ * @return 1 if all the values were added, 0 otherwise (then none of them is
+ * added).
+ */
+int vector_push_back_many(vector *vector, const void *const *values, size_t n);
+
+/**
+ * Adds a value to the back of the vector without copying it. The vector
+ * takes ownership of value, and frees it with elem_free_func.
+ * @param vector a pointer to vector.
+ * @param value dynamically allocated value to be adopted by the vector.
+ * @return 1 if the adding has been done successfully, 0 otherwise (then the
+ * caller still owns value).
+ */
+int vector_emplace_owned(vector *vector, void *value);
+
+/**
+ * Makes sure the vector can hold size elements without growing.
+ * @param vector a pointer to vector.
+ * @param size the number of elements.
+ * @return 1 upon success, 0 otherwise.
+ */
+int vector_reserve(vector *vector, size_t size);
+
+/**
+ * Shrinks the capacity of the vector to the smallest one holding its
+ * elements.
+ * @param vector a pointer to vector.
+ * @return 1 upon success, 0 otherwise.
+ */
+int vector_shrink_to_fit(vector *vector);
+
 /**
  * This function returns the load factor of the vector.
  * @param vector a vector.
@@ -132,7 +168,17 @@ double vector_get_load_factor(const vector *vector);
 int vector_erase(vector *vector, size_t ind);
 
 /**
- * Deletes all the elements in the vector.
+ * Removes the element at the given index from the vector by moving the last
+ * element into its place. Unlike vector_erase, it does not keep the order of
+ * the remaining elements and never shrinks the vector, so it takes O(1).
+ * @param vector a pointer to vector.
+ * @param ind the index of the element to be removed.
+ * @return 1 if the removing has been done successfully, 0 otherwise.
+ */
+int vector_erase_unordered(vector *vector, size_t ind);
+
+/**
+ * Deletes all the elements in the vector, keeping its capacity.
  * @param vector vector a pointer to vector.
  */
 void vector_clear(vector *vector);